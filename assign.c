@@ -74,9 +74,13 @@ void DoAssign(void);
 void DoAssignAdjust(TestControlStruct *locassignstruct);
 void* AssignFunc(void *data);
 static void DoAssignIteration(farlong *arraybase,
+		farlong *pristine,
 		ulong numarrays,StopWatchStruct *stopwatch);
 static void LoadAssignArrayWithRand(farlong *arraybase,
 		ulong numarrays);
+static void RestoreAssignArray(farlong *arraybase,
+		farlong *pristine,
+		ulong numarrays);
 static void LoadAssign(farlong arraybase[][ASSIGNCOLS]);
 static void CopyToAssign(farlong arrayfrom[][ASSIGNCOLS],
 		long arrayto[][ASSIGNCOLS]);
@@ -171,7 +175,7 @@ void DoAssignAdjust(TestControlStruct *locassignstruct)
              ** try again.
              */
             ResetStopWatch(&stopwatch);
-            DoAssignIteration(arraybase,
+            DoAssignIteration(arraybase,(farlong *)NULL,
                         locassignstruct->numarrays,&stopwatch);
 
             FreeMemory((farvoid *)arraybase, &systemerror);
@@ -212,16 +216,19 @@ void* AssignFunc(void *data)
     TestControlStruct *locassignstruct;    /* Local pointer to global struct */
     StopWatchStruct stopwatch;             /* Stop watch to time the test */
     farlong *arraybase;     /* Base pointers of array */
+    farlong *pristine;      /* Cost table to restore from */
     int systemerror;        /* For holding error codes */
 
     testdata = (TestThreadData *)data;
     locassignstruct = testdata->control;
 
     /*
-     ** Allocate space for arrays
+     ** Allocate space for arrays, and one more that keeps the
+     ** cost table, generated once, for every iteration to
+     ** restore.
      */
     arraybase=(farlong *)AllocateMemory(sizeof(long)*
-                ASSIGNROWS*ASSIGNCOLS*locassignstruct->numarrays,
+                ASSIGNROWS*ASSIGNCOLS*(locassignstruct->numarrays+1),
                 &systemerror);
     if(systemerror)
     {
@@ -230,6 +237,8 @@ void* AssignFunc(void *data)
                     &systemerror);
         ErrorExit();
     }
+    pristine=arraybase+ASSIGNROWS*ASSIGNCOLS*locassignstruct->numarrays;
+    LoadAssignArrayWithRand(pristine,1);
 
     /*
      ** All's well if we get here.  Do the tests.
@@ -238,7 +247,7 @@ void* AssignFunc(void *data)
     ResetStopWatch(&stopwatch);
 
     do {
-        DoAssignIteration(arraybase,
+        DoAssignIteration(arraybase,pristine,
                 locassignstruct->numarrays,&stopwatch);
         testdata->result.iterations+=(double)1.0;
     } while(stopwatch.realsecs<locassignstruct->request_secs);
@@ -260,8 +269,12 @@ void* AssignFunc(void *data)
 ***********************
 ** This routine executes one iteration of the assignment test.
 ** It returns the number of ticks elapsed in the iteration.
+** The arrays are copied from pristine, if there is one,
+** rather than generated again; with FRESHDATA every
+** iteration still generates its own.
 */
 static void DoAssignIteration(farlong *arraybase,
+    farlong *pristine,
     ulong numarrays, StopWatchStruct *stopwatch)
 {
     longptr abase;                  /* local pointer */
@@ -275,7 +288,10 @@ static void DoAssignIteration(farlong *arraybase,
     /*
      ** Load up the arrays with a random table.
      */
-    LoadAssignArrayWithRand(arraybase,numarrays);
+    if(pristine!=(farlong *)NULL && !global_freshdata)
+        RestoreAssignArray(arraybase,pristine,numarrays);
+    else
+        LoadAssignArrayWithRand(arraybase,numarrays);
 
     /*
      ** Start the stopwatch
@@ -332,6 +348,24 @@ static void LoadAssignArrayWithRand(farlong *arraybase,
     return;
 }
 
+/***********************
+** RestoreAssignArray **
+************************
+** Copy the cost table LoadAssignArrayWithRand() built at
+** pristine into each of the arrays.
+*/
+static void RestoreAssignArray(farlong *arraybase,
+    farlong *pristine,
+    ulong numarrays)
+{
+    ulong i;
+
+    for(i=0;i<numarrays;i++)
+        memcpy((void *)(arraybase+i*ASSIGNROWS*ASSIGNCOLS),(void *)pristine,
+                (size_t)(ASSIGNROWS*ASSIGNCOLS)*sizeof(long));
+    return;
+}
+
 /***************
 ** LoadAssign **
 ****************
@@ -346,7 +380,7 @@ static void LoadAssign(farlong arraybase[][ASSIGNCOLS])
      ** Reset random number generator so things repeat.
      */
     /* randnum(13L); */
-    randnum((int32)13);
+    randdata();
 
     for(i=0;i<ASSIGNROWS;i++)
         for(j=0;j<ASSIGNROWS;j++){
@@ -136,6 +136,7 @@ void DoBitopsAdjust(TestControlStruct *locbitopstruct)
              ** larger version, and try again.
              */
             ResetStopWatch(&stopwatch);
+            nbitops=0L;
             DoBitfieldIteration(bitarraybase,
                     bitoparraybase,
                     locbitopstruct->bitoparraysize,
@@ -223,6 +224,7 @@ void *BitopsFunc(void *data)
      */
     testdata->result.iterations = 0.0;
     ResetStopWatch(&stopwatch);
+    nbitops=0L;
 
     do {
         DoBitfieldIteration(bitarraybase, bitoparraybase,
@@ -248,6 +250,10 @@ void *BitopsFunc(void *data)
 *************************
 ** Perform a single iteration of the bitfield benchmark.
 ** Return the # of ticks accumulated by the operation.
+** The table of operations is built only if *nbitops is 0,
+** or with FRESHDATA; otherwise the table and *nbitops of the
+** previous iteration are used again, since the test does not
+** change them.  The bitmap is reset every time.
 */
 static void DoBitfieldIteration(farulong *bitarraybase,
         farulong *bitoparraybase,
@@ -257,10 +263,14 @@ static void DoBitfieldIteration(farulong *bitarraybase,
 {
     long i;                         /* Index */
     ulong bitoffset;                /* Offset into bitmap */
+    int rebuild;                    /* Build the operations table */
+
+    rebuild=*nbitops==0L || global_freshdata;
     /*
      ** Clear # bitops counter
      */
-    *nbitops=0L;
+    if(rebuild)
+        *nbitops=0L;
 
     /*
      ** Construct a set of bitmap offsets and run lengths.
@@ -276,7 +286,8 @@ static void DoBitfieldIteration(farulong *bitarraybase,
      ** Also reset the bit array we work on.
      ** added by Uwe F. Mayer
      */
-    randnum((int32)13);
+    if(rebuild)
+        randdata();
     for (i=0;i<global_bitopstruct.bitfieldarraysize;i++)
     {
 #ifdef LONG64
@@ -285,10 +296,11 @@ static void DoBitfieldIteration(farulong *bitarraybase,
         *(bitarraybase+i)=(ulong)0x55555555;
 #endif
     }
-    randnum((int32)13);
+    if(rebuild)
+        randdata();
     /* end of addition of code */
 
-    for (i=0;i<bitoparraysize;i++)
+    for (i=0;i<bitoparraysize && rebuild;i++)
     {
         /* First item is offset */
         /* *(bitoparraybase+i+i)=bitoffset=abs_randwc(262140L); */
@@ -358,6 +370,7 @@ static void ToggleBitRun(farulong *bitmap, /* Bitmap */
     unsigned long bindex;   /* Index into array */
     unsigned long bitnumb;  /* Bit number */
 
+    OPCOUNT_ADD(OP_BITS,nbits);
     while(nbits--)
     {
 #ifdef LONG64
@@ -388,6 +401,7 @@ static void FlipBitRun(farulong *bitmap,        /* Bit map */
     unsigned long bindex;   /* Index into array */
     unsigned long bitnumb;  /* Bit number */
 
+    OPCOUNT_ADD(OP_BITS,nbits);
     while(nbits--)
     {
 #ifdef LONG64
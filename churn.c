@@ -0,0 +1,419 @@
+/*
+** churn.c
+** Allocator churn test.
+**
+** The BYTEmark kernels allocate their buffers before the clock
+** starts, so none of the scores sees the allocator.  This test
+** does nothing but allocate and free: every thread keeps a set
+** of live blocks and replaces one at random on every operation,
+** with sizes drawn from a mix of small objects, medium buffers
+** and the odd block large enough to be mmap'd.  With more than
+** one thread, part of the blocks are handed to the next thread
+** and freed there, as a producer-consumer pipeline would.  The
+** score is operations (one free plus one allocation) per
+** second; it does not count toward any index.  ChurnRate()
+** times the same mix on one thread through malloc() or through
+** AllocateMemory(), for the report's comparison.
+*/
+
+/*
+** INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "sysspec.h"
+#include "misc.h"
+
+#if defined(LINUX) || defined(OSX)
+#include <pthread.h>
+#endif
+#ifdef LINUX
+#include <unistd.h>
+#endif
+
+/*
+** Resident set size around the runs of the test, bytes: before
+** the first, at the peak of any, and after the last freed its
+** blocks.
+*/
+double global_churnrss[CHURNRSSKINDS];
+
+/*
+** One thread's state.  Blocks the thread passes on are posted
+** to the mailbox of thread mail, -1 for none.
+*/
+typedef struct {
+    void **slots;           /* Live blocks, NULL where empty */
+    ulong live;             /* # of slots */
+    int kind;               /* CHURN_MALLOC or CHURN_ALLOCMEM */
+    int mail;               /* Mailbox to pass blocks to */
+    unsigned long long rng; /* xorshift64 state */
+} ChurnThreadStruct;
+
+/*
+** Blocks posted to a thread and not yet freed by it.
+*/
+typedef struct {
+#if defined(LINUX) || defined(OSX)
+    pthread_mutex_t lock;
+#endif
+    int count;
+    void *items[CHURNMAIL];
+} ChurnMailStruct;
+
+static ChurnMailStruct *churn_mail;     /* One mailbox per thread */
+static int churn_next;                  /* Next thread number */
+#if defined(LINUX) || defined(OSX)
+static pthread_mutex_t churn_lock=PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/*
+** PROTOTYPES
+*/
+void DoChurn(void);
+static void *ChurnFunc(void *data);
+static ulong churn_size(ulong r);
+static void *churn_alloc(int kind, ulong nbytes);
+static void churn_free(int kind, void *p);
+static void churn_ops(ChurnThreadStruct *t, ulong nops);
+static void churn_drain(int id);
+static double rss_bytes(void);
+
+/************
+** DoChurn **
+*************
+** Perform the allocator churn test.  There is nothing to
+** adjust; every iteration is one free and one allocation.
+** The mailboxes live here so that blocks still in them when
+** the threads finish can be freed.
+*/
+void DoChurn(void)
+{
+    TestControlStruct *locchurnstruct;    /* Local churn structure */
+    int i;
+
+    locchurnstruct=&global_churnstruct;
+    locchurnstruct->adjust=1;
+
+    churn_mail=(ChurnMailStruct *)malloc(sizeof(ChurnMailStruct)*global_concurrency);
+    if(churn_mail==(ChurnMailStruct *)NULL)
+    {
+        ReportError(locchurnstruct->errorcontext,ERROR_MEMORY);
+        ErrorExit();
+    }
+    for(i=0;i<global_concurrency;i++)
+    {
+#if defined(LINUX) || defined(OSX)
+        pthread_mutex_init(&churn_mail[i].lock,NULL);
+#endif
+        churn_mail[i].count=0;
+    }
+    churn_next=0;
+    if(global_churnrss[CHURN_RSSBEFORE]==(double)0.0)
+    {   global_churnrss[CHURN_RSSBEFORE]=rss_bytes();
+        global_churnrss[CHURN_RSSPEAK]=global_churnrss[CHURN_RSSBEFORE];
+    }
+
+    run_bench_with_concurrency(locchurnstruct, ChurnFunc);
+
+    for(i=0;i<global_concurrency;i++)
+    {   churn_drain(i);
+#if defined(LINUX) || defined(OSX)
+        pthread_mutex_destroy(&churn_mail[i].lock);
+#endif
+    }
+    free(churn_mail);
+    global_churnrss[CHURN_RSSAFTER]=rss_bytes();
+}
+
+/**************
+** ChurnFunc **
+***************
+** Body of one churn thread.  The slots are filled untimed;
+** then every timed region replaces CHURNOPS blocks and frees
+** what the previous thread posted meanwhile.
+*/
+static void *ChurnFunc(void *data)
+{
+    TestThreadData *testdata;       /* test data passed from thread func */
+    TestControlStruct *locchurnstruct;      /* Local pointer to global struct */
+    StopWatchStruct stopwatch;      /* Stop watch to time the test */
+    ChurnThreadStruct t;
+    double rss;
+    int systemerror;                /* For holding error code */
+    int id;
+    ulong i;
+
+    testdata=(TestThreadData *)data;
+    locchurnstruct=testdata->control;
+
+#if defined(LINUX) || defined(OSX)
+    pthread_mutex_lock(&churn_lock);
+#endif
+    id=churn_next++;
+#if defined(LINUX) || defined(OSX)
+    pthread_mutex_unlock(&churn_lock);
+#endif
+
+    t.live=locchurnstruct->arraysize;
+    t.kind=CHURN_MALLOC;
+    t.mail=global_concurrency>1 ? (id+1)%global_concurrency : -1;
+    t.rng=0x9E3779B97F4A7C15ULL*(unsigned long long)(id+1);
+    t.slots=(void **)AllocateMemory(t.live*sizeof(void *),&systemerror);
+    if(systemerror)
+    {
+        ReportError(locchurnstruct->errorcontext,systemerror);
+        ErrorExit();
+    }
+    for(i=0;i<t.live;i++)
+        t.slots[i]=NULL;
+    churn_ops(&t,t.live);
+
+    testdata->result.iterations=0.0;
+    ResetStopWatch(&stopwatch);
+    do {
+        StartStopWatch(&stopwatch);
+        churn_ops(&t,CHURNOPS);
+        churn_drain(id);
+        StopStopWatch(&stopwatch);
+        testdata->result.iterations+=(double)CHURNOPS;
+    } while(stopwatch.realsecs<locchurnstruct->request_secs);
+
+    /*
+     ** The peak is taken while every thread still holds its
+     ** blocks, or close to it.
+     */
+    rss=rss_bytes();
+#if defined(LINUX) || defined(OSX)
+    pthread_mutex_lock(&churn_lock);
+#endif
+    if(rss>global_churnrss[CHURN_RSSPEAK])
+        global_churnrss[CHURN_RSSPEAK]=rss;
+#if defined(LINUX) || defined(OSX)
+    pthread_mutex_unlock(&churn_lock);
+#endif
+
+    for(i=0;i<t.live;i++)
+        if(t.slots[i]!=NULL)
+            churn_free(t.kind,t.slots[i]);
+    FreeMemory((farvoid *)t.slots,&systemerror);
+
+    testdata->result.cpusecs=stopwatch.cpusecs;
+    testdata->result.realsecs=stopwatch.realsecs;
+
+    return 0;
+}
+
+/**************
+** ChurnRate **
+***************
+** Run the churn mix on the calling thread for at least secs
+** seconds, with live blocks through allocator kind, and
+** return the operations per second.  Nothing is passed to
+** other threads.  Returns a negative value if the blocks
+** can't be had; AllocateMemory() can hold only MEM_ARRAY_SIZE
+** blocks at a time.
+*/
+double ChurnRate(int kind, ulong live, double secs)
+{
+    StopWatchStruct stopwatch;      /* Stop watch to time the mix */
+    ChurnThreadStruct t;
+    double ops;
+    ulong i;
+
+    if(kind==CHURN_ALLOCMEM && mem_array_ents+(int)live>MEM_ARRAY_SIZE)
+        return((double)-1.0);
+    t.slots=(void **)malloc((size_t)live*sizeof(void *));
+    if(t.slots==(void **)NULL)
+        return((double)-1.0);
+    t.live=live;
+    t.kind=kind;
+    t.mail=-1;
+    t.rng=0x9E3779B97F4A7C15ULL;
+    for(i=0;i<live;i++)
+        t.slots[i]=NULL;
+    churn_ops(&t,live);
+
+    ops=(double)0.0;
+    ResetStopWatch(&stopwatch);
+    do {
+        StartStopWatch(&stopwatch);
+        churn_ops(&t,CHURNOPS/4);
+        StopStopWatch(&stopwatch);
+        ops+=(double)(CHURNOPS/4);
+    } while(stopwatch.realsecs<secs);
+
+    for(i=0;i<live;i++)
+        if(t.slots[i]!=NULL)
+            churn_free(kind,t.slots[i]);
+    free(t.slots);
+    return(ops/stopwatch.realsecs);
+}
+
+/***************
+** churn_size **
+****************
+** Size of the next block, from the random value r: 70% small
+** objects of 16 to 256 bytes, 25% buffers up to 4 KB, 4% up to
+** 64 KB and 1% up to 256 KB, beyond malloc's default mmap
+** threshold.
+*/
+static ulong churn_size(ulong r)
+{
+    ulong c;
+
+    c=r%100;
+    r/=100;
+    if(c<70) return(16+r%241);
+    if(c<95) return(257+r%3840);
+    if(c<99) return(4097+r%61440);
+    return(65537+r%196608);
+}
+
+/****************
+** churn_alloc **
+*****************
+** Allocate nbytes through allocator kind.  A failure is fatal,
+** as it is for the other tests' buffers.
+*/
+static void *churn_alloc(int kind, ulong nbytes)
+{
+    void *p;
+    int systemerror;
+
+    if(kind==CHURN_ALLOCMEM)
+    {   p=(void *)AllocateMemory(nbytes,&systemerror);
+        if(systemerror)
+        {   ReportError(global_churnstruct.errorcontext,systemerror);
+            ErrorExit();
+        }
+        return(p);
+    }
+    p=malloc((size_t)nbytes);
+    if(p==NULL)
+    {   ReportError(global_churnstruct.errorcontext,ERROR_MEMORY);
+        ErrorExit();
+    }
+    return(p);
+}
+
+/***************
+** churn_free **
+****************
+** Free p through allocator kind.
+*/
+static void churn_free(int kind, void *p)
+{
+    int systemerror;
+
+    if(kind==CHURN_ALLOCMEM)
+        FreeMemory((farvoid *)p,&systemerror);
+    else
+        free(p);
+}
+
+/**************
+** churn_ops **
+***************
+** Replace nops blocks of t at random slots.  Every block gets
+** its first line and its last byte written, as a constructor
+** would.  One in CHURNCROSS of the blocks replaced is posted to
+** the next thread instead of freed, unless its mailbox is
+** full.
+*/
+static void churn_ops(ChurnThreadStruct *t, ulong nops)
+{
+    ChurnMailStruct *m;
+    unsigned long long x;
+    ulong slot, nbytes;
+    char *p;
+    int posted;
+
+    x=t->rng;
+    while(nops--)
+    {
+        x^=x<<13;
+        x^=x>>7;
+        x^=x<<17;
+        slot=(ulong)(x>>32)%t->live;
+        if(t->slots[slot]!=NULL)
+        {
+            posted=0;
+            if(t->mail>=0 && (x&(CHURNCROSS-1))==0)
+            {   m=&churn_mail[t->mail];
+#if defined(LINUX) || defined(OSX)
+                pthread_mutex_lock(&m->lock);
+#endif
+                if(m->count<CHURNMAIL)
+                {   m->items[m->count++]=t->slots[slot];
+                    posted=1;
+                }
+#if defined(LINUX) || defined(OSX)
+                pthread_mutex_unlock(&m->lock);
+#endif
+            }
+            if(!posted)
+                churn_free(t->kind,t->slots[slot]);
+        }
+        nbytes=churn_size((ulong)(x>>8));
+        p=(char *)churn_alloc(t->kind,nbytes);
+        memset(p,(int)slot,(size_t)(nbytes<64 ? nbytes : 64));
+        p[nbytes-1]=(char)nbytes;
+        t->slots[slot]=(void *)p;
+    }
+    t->rng=x;
+}
+
+/****************
+** churn_drain **
+*****************
+** Free every block posted to thread id.  The mailbox is
+** emptied under its lock and the blocks freed after, so the
+** producer is not held up by the frees.
+*/
+static void churn_drain(int id)
+{
+    ChurnMailStruct *m;
+    void *items[CHURNMAIL];
+    int i, n;
+
+    m=&churn_mail[id];
+#if defined(LINUX) || defined(OSX)
+    pthread_mutex_lock(&m->lock);
+#endif
+    n=m->count;
+    for(i=0;i<n;i++)
+        items[i]=m->items[i];
+    m->count=0;
+#if defined(LINUX) || defined(OSX)
+    pthread_mutex_unlock(&m->lock);
+#endif
+    for(i=0;i<n;i++)
+        free(items[i]);
+}
+
+/**************
+** rss_bytes **
+***************
+** Resident set size of the process in bytes, from
+** /proc/self/statm; 0 where that can't be read.
+*/
+static double rss_bytes(void)
+{
+#ifdef LINUX
+    FILE *fp;
+    long size, resident;
+
+    fp=fopen("/proc/self/statm","r");
+    if(fp==(FILE *)NULL)
+        return((double)0.0);
+    if(fscanf(fp,"%ld %ld",&size,&resident)!=2)
+        resident=0;
+    fclose(fp);
+    return((double)resident*(double)sysconf(_SC_PAGESIZE));
+#else
+    return((double)0.0);
+#endif
+}
@@ -0,0 +1,86 @@
+
+/*
+** cold.c
+** Cold-cache measurement mode.
+**
+** The kernels reuse the same small buffers from one timed
+** iteration to the next, so after the first iteration they run
+** entirely from cache.  In cold mode StartStopWatch() calls
+** ColdEvict() before every timed region: it flushes all live
+** benchmark blocks (see FlushMemArray()) and then reads through
+** a buffer twice the size of the last-level cache, which pushes
+** out the stack, the static tables and anything the flush missed.
+** Eviction happens before the clock starts, so it is not timed.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "sysspec.h"
+#include "cold.h"
+#include "hardware.h"
+
+/*
+** Global parameters.
+*/
+int global_cold;                /* Cold-cache runs requested */
+int global_cold_on;             /* Evict before every timed region */
+
+#define COLD_MINBYTES (8UL<<20)         /* Smallest eviction buffer */
+#define COLD_DEFBYTES (64UL<<20)        /* When the LLC size is unknown */
+
+static char *cold_buf;                  /* Eviction buffer */
+static unsigned long cold_bytes;        /* Its size */
+static volatile char cold_sink;
+
+/*************
+** ColdInit **
+**************
+** Size and allocate the eviction buffer.
+** Returns 0 if ok, -1 if it can't be allocated; in that case
+** reason holds a short explanation.
+*/
+int ColdInit(char *reason)
+{
+    unsigned long i;
+
+    cold_bytes=2*LLCSize();
+    if(cold_bytes==0) cold_bytes=COLD_DEFBYTES;
+    if(cold_bytes<COLD_MINBYTES) cold_bytes=COLD_MINBYTES;
+    cold_buf=(char *)malloc(cold_bytes);
+    if(cold_buf==(char *)NULL)
+    {   strcpy(reason,"not enough memory for the eviction buffer");
+        return(-1);
+    }
+    for(i=0;i<cold_bytes;i++)
+        cold_buf[i]=(char)i;
+    return(0);
+}
+
+/*******************
+** ColdBufferSize **
+********************
+** Size of the eviction buffer, in bytes.
+*/
+unsigned long ColdBufferSize(void)
+{
+    return(cold_bytes);
+}
+
+/**************
+** ColdEvict **
+***************
+** Leave nothing of the benchmark's data in the caches.
+*/
+void ColdEvict(void)
+{
+    unsigned long i;
+    char sum;
+
+    FlushMemArray();
+    sum=0;
+    for(i=0;i<cold_bytes;i+=64)
+        sum+=cold_buf[i];
+    cold_sink=sum;
+}
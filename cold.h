@@ -0,0 +1,18 @@
+/*
+** cold.h
+** Header for cold.c
+** Cold-cache measurement mode.
+*/
+
+/*
+** EXTERNALS
+*/
+extern int global_cold;         /* Cold-cache runs requested */
+extern int global_cold_on;      /* Evict before every timed region */
+
+/*
+** PROTOTYPES
+*/
+int ColdInit(char *reason);
+unsigned long ColdBufferSize(void);
+void ColdEvict(void);
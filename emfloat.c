@@ -288,8 +288,7 @@ void SetupCPUEmFloatArrays(InternalFPF *abase,
     /*
      ** Reset random number generator so things repeat. Inserted by Uwe F. Mayer.
      */
-    extern int32 randnum(int32 lngval);
-    randnum((int32)13);
+    randdata();
 
     for(i=0;i<arraysize;i++)
     {/*       LongToInternalFPF(randwc(50000L),&locFPF1); */
@@ -0,0 +1,324 @@
+
+/*
+** energy.c
+** Package and DRAM energy from the powercap (RAPL) interface.
+**
+** Linux publishes the RAPL energy counters of Intel and (since
+** 5.8) AMD processors under /sys/class/powercap/intel-rapl:N,
+** one zone per package with a "dram" subzone where the hardware
+** meters it.  The counters are in microjoules and wrap at
+** max_energy_range_uj.  On many systems only root can read them;
+** then, as on hosts without RAPL, energy is unavailable and
+** nothing else changes.
+**
+** The counters are read from the stopwatch: when the first
+** benchmark thread enters a timed region and when the last one
+** leaves it, so that only timed work is charged, not data setup
+** or calibration.  The counters tick about once a millisecond;
+** over many short regions the deltas still add up to the right
+** total on average.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "energy.h"
+
+#ifdef LINUX
+#include <pthread.h>
+#endif
+
+/*
+** Global parameters.
+*/
+int global_energy;              /* Energy reporting requested */
+
+#ifdef LINUX
+
+#define POWERCAP_SYSFS "/sys/class/powercap"
+#define MAXZONES 16             /* Packages plus DRAM subzones */
+
+/*
+** TYPEDEFS
+*/
+typedef struct {
+    char path[128];         /* energy_uj file */
+    int dram;               /* DRAM subzone */
+} ZoneStruct;
+
+static ZoneStruct zones[MAXZONES];
+static int nzones;
+static int have_dram;
+static double pkg_range;        /* Counter wraparound, joules */
+static double dram_range;
+
+static int energy_active;       /* Threads inside a timed region */
+static EnergyStruct energy_start;       /* Reading as the first entered */
+static EnergyStruct energy_timed;       /* Used by timed regions so far */
+static pthread_mutex_t energy_lock=PTHREAD_MUTEX_INITIALIZER;
+
+/*
+** PROTOTYPES
+*/
+static int read_double(char *path, double *value);
+static int read_name(char *path, char *name, int len);
+static void add_zone(char *dir, int dram);
+
+/****************
+** read_double **
+*****************
+** Read a single number from a sysfs file.
+** Returns 0 if ok, -1 if the file can't be read.
+*/
+static int read_double(char *path, double *value)
+{
+    FILE *fp;
+    int n;
+
+    fp=fopen(path,"r");
+    if(fp==(FILE *)NULL) return(-1);
+    n=fscanf(fp,"%lf",value);
+    fclose(fp);
+    return(n==1 ? 0 : -1);
+}
+
+/**************
+** read_name **
+***************
+** Read a zone's name file.
+** Returns 0 if ok, -1 if the file can't be read.
+*/
+static int read_name(char *path, char *name, int len)
+{
+    FILE *fp;
+
+    fp=fopen(path,"r");
+    if(fp==(FILE *)NULL) return(-1);
+    if(fgets(name,len,fp)==(char *)NULL) name[0]='\0';
+    fclose(fp);
+    name[strcspn(name,"\n")]='\0';
+    return(0);
+}
+
+/*************
+** add_zone **
+**************
+** Add the zone in directory dir if its counter can be read.
+*/
+static void add_zone(char *dir, int dram)
+{
+    ZoneStruct *z;
+    char path[128];
+    double value, range;
+
+    if(nzones==MAXZONES) return;
+    z=&zones[nzones];
+    sprintf(z->path,"%.100s/energy_uj",dir);
+    if(read_double(z->path,&value)) return;
+    sprintf(path,"%.100s/max_energy_range_uj",dir);
+    range=(double)0.0;
+    read_double(path,&range);
+    z->dram=dram;
+    if(dram)
+    {   have_dram=1;
+        dram_range=range*1e-6;
+    }
+    else
+        pkg_range=range*1e-6;
+    nzones++;
+}
+
+/***************
+** EnergyInit **
+****************
+** Find the package and DRAM zones.
+** Returns 0 if at least one package counter is readable,
+** -1 if not; in that case reason holds a short explanation.
+*/
+int EnergyInit(char *reason)
+{
+    char dir[128], path[128], name[32];
+    int p, s, found;
+
+    nzones=0;
+    have_dram=0;
+    found=0;
+    for(p=0;p<MAXZONES;p++)
+    {
+        sprintf(dir,POWERCAP_SYSFS "/intel-rapl:%d",p);
+        sprintf(path,"%.100s/name",dir);
+        if(read_name(path,name,sizeof(name))) break;
+        found=1;
+        if(strncmp(name,"package",7)!=0) continue;
+        add_zone(dir,0);
+        for(s=0;s<MAXZONES;s++)
+        {
+            sprintf(dir,POWERCAP_SYSFS "/intel-rapl:%d:%d",p,s);
+            sprintf(path,"%.100s/name",dir);
+            if(read_name(path,name,sizeof(name))) break;
+            if(strcmp(name,"dram")==0)
+                add_zone(dir,1);
+        }
+    }
+    if(nzones==0)
+    {   strcpy(reason,found ? "RAPL energy counters not readable (root only?)" :
+                "no RAPL powercap zones");
+        return(-1);
+    }
+    return(0);
+}
+
+/********************
+** EnergyAvailable **
+*********************
+** Nonzero if EnergyInit() found a readable counter.
+*/
+int EnergyAvailable(void)
+{
+    return(nzones>0);
+}
+
+/***************
+** EnergyRead **
+****************
+** Read the package and DRAM counters, summed over packages.
+*/
+void EnergyRead(EnergyStruct *e)
+{
+    double value;
+    int i;
+
+    e->pkg=(double)0.0;
+    e->dram=have_dram ? (double)0.0 : (double)-1.0;
+    for(i=0;i<nzones;i++)
+    {
+        if(read_double(zones[i].path,&value)) value=(double)0.0;
+        if(zones[i].dram)
+            e->dram+=value*1e-6;
+        else
+            e->pkg+=value*1e-6;
+    }
+}
+
+/****************
+** EnergyDelta **
+*****************
+** Energy used between two readings.  A counter that wrapped
+** once is corrected with its range (all packages are assumed
+** to share one range).
+*/
+void EnergyDelta(EnergyStruct *start, EnergyStruct *end, EnergyStruct *delta)
+{
+    delta->pkg=end->pkg-start->pkg;
+    if(delta->pkg<(double)0.0)
+        delta->pkg+=pkg_range;
+    delta->dram=(double)-1.0;
+    if(have_dram)
+    {   delta->dram=end->dram-start->dram;
+        if(delta->dram<(double)0.0)
+            delta->dram+=dram_range;
+    }
+}
+
+/**********************
+** EnergyRegionBegin **
+***********************
+** Called by the benchmark threads from StartStopWatch(), before
+** the clock starts.  The first thread in takes the opening
+** reading.
+*/
+void EnergyRegionBegin(void)
+{
+    if(!global_energy || nzones==0) return;
+    pthread_mutex_lock(&energy_lock);
+    if(energy_active++==0)
+        EnergyRead(&energy_start);
+    pthread_mutex_unlock(&energy_lock);
+}
+
+/********************
+** EnergyRegionEnd **
+*********************
+** Called by the benchmark threads from StopStopWatch(), after
+** the clock stops.  The last thread out adds the energy used
+** since the opening reading.
+*/
+void EnergyRegionEnd(void)
+{
+    EnergyStruct end, delta;
+
+    if(!global_energy || nzones==0) return;
+    pthread_mutex_lock(&energy_lock);
+    if(--energy_active==0)
+    {   EnergyRead(&end);
+        EnergyDelta(&energy_start,&end,&delta);
+        energy_timed.pkg+=delta.pkg;
+        if(have_dram)
+            energy_timed.dram+=delta.dram;
+    }
+    pthread_mutex_unlock(&energy_lock);
+}
+
+/*********************
+** EnergyTimedReset **
+**********************
+** Start a new total of the energy used in timed regions.
+*/
+void EnergyTimedReset(void)
+{
+    energy_active=0;
+    energy_timed.pkg=(double)0.0;
+    energy_timed.dram=have_dram ? (double)0.0 : (double)-1.0;
+}
+
+/****************
+** EnergyTimed **
+*****************
+** Energy used in timed regions since EnergyTimedReset().
+*/
+void EnergyTimed(EnergyStruct *e)
+{
+    *e=energy_timed;
+}
+
+#else
+
+/*
+** Elsewhere there are no energy counters.
+*/
+int EnergyInit(char *reason)
+{
+    strcpy(reason,"not supported on this system");
+    return(-1);
+}
+
+int EnergyAvailable(void)
+{
+    return(0);
+}
+
+void EnergyRead(EnergyStruct *e)
+{
+    e->pkg=(double)0.0;
+    e->dram=(double)-1.0;
+}
+
+void EnergyDelta(EnergyStruct *start, EnergyStruct *end, EnergyStruct *delta)
+{
+    delta->pkg=(double)0.0;
+    delta->dram=(double)-1.0;
+}
+
+void EnergyRegionBegin(void) { }
+
+void EnergyRegionEnd(void) { }
+
+void EnergyTimedReset(void) { }
+
+void EnergyTimed(EnergyStruct *e)
+{
+    e->pkg=(double)0.0;
+    e->dram=(double)-1.0;
+}
+
+#endif
@@ -0,0 +1,30 @@
+/*
+** energy.h
+** Header for energy.c
+** Package and DRAM energy from the powercap (RAPL) interface.
+*/
+
+/*
+** TYPEDEFS
+*/
+typedef struct {
+    double pkg;             /* Package energy, joules (reading or delta) */
+    double dram;            /* DRAM energy, joules; negative if unknown */
+} EnergyStruct;
+
+/*
+** EXTERNALS
+*/
+extern int global_energy;       /* Energy reporting requested */
+
+/*
+** PROTOTYPES
+*/
+int EnergyInit(char *reason);
+int EnergyAvailable(void);
+void EnergyRead(EnergyStruct *e);
+void EnergyDelta(EnergyStruct *start, EnergyStruct *end, EnergyStruct *delta);
+void EnergyRegionBegin(void);
+void EnergyRegionEnd(void);
+void EnergyTimedReset(void);
+void EnergyTimed(EnergyStruct *e);
@@ -0,0 +1,372 @@
+/*
+** fault.c
+** Page fault test.
+**
+** The tests build their data untimed, so the cost of getting
+** fresh memory from the kernel never shows in a score: mapping
+** it, faulting every page in on first touch, handing it back
+** with madvise(MADV_DONTNEED) and unmapping it.  This test runs
+** nothing but that cycle over a region of FAULTSIZE bytes and
+** times each step, on 4 KB pages or on huge pages.  Run on
+** several threads at once, the steps also contend for the
+** process's address space lock.  The score is cycles per
+** second; it does not count toward any index.
+*/
+
+/*
+** INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "sysspec.h"
+#include "misc.h"
+
+#if defined(LINUX) || defined(OSX)
+#include <pthread.h>
+#endif
+#ifdef LINUX
+#include <sys/mman.h>
+#endif
+
+#define FAULTHUGEPAGE (1UL<<21)         /* Huge page size used */
+
+int global_faultsmall;          /* Kernel refused huge pages: 4 KB used */
+
+/*
+** Work handed to each thread of FaultRun().
+*/
+typedef struct {
+    int huge;                       /* Map with huge pages */
+    ulong nbytes;                   /* Region size */
+    double secs;                    /* Seconds to cycle for */
+    double cycles;                  /* Cycles done */
+    int failed;                     /* Could not get the pages */
+    StopWatchStruct watch[FAULTPHASES];     /* One per step */
+} FaultThreadStruct;
+
+/*
+** FaultRun() starts its threads together: they wait for
+** fault_go to be set.
+*/
+static int fault_go;
+#if defined(LINUX) || defined(OSX)
+static pthread_mutex_t fault_lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fault_start=PTHREAD_COND_INITIALIZER;
+#endif
+
+/*
+** PROTOTYPES
+*/
+void DoFault(void);
+static void *FaultFunc(void *data);
+static void *fault_thread(void *data);
+static int fault_cycle(int huge, ulong nbytes, StopWatchStruct *watch);
+static void touch(volatile char *p, ulong nbytes);
+
+/************
+** DoFault **
+*************
+** Perform the page fault test.  There is nothing to adjust;
+** every iteration is one cycle over the whole region.
+*/
+void DoFault(void)
+{
+    TestControlStruct *locfaultstruct;    /* Local fault structure */
+
+    locfaultstruct=&global_faultstruct;
+    locfaultstruct->adjust=1;
+
+    run_bench_with_concurrency(locfaultstruct, FaultFunc);
+}
+
+/**************
+** FaultFunc **
+***************
+** Body of one page fault thread: cycle a region of its own,
+** with the pages of the HUGEPAGES policy, until the requested
+** time is up.  If the kernel refuses huge pages the thread
+** starts over on 4 KB pages and sets global_faultsmall, so
+** that the report says so.
+*/
+static void *FaultFunc(void *data)
+{
+    TestThreadData *testdata;       /* test data passed from thread func */
+    TestControlStruct *locfaultstruct;      /* Local pointer to global struct */
+    StopWatchStruct watch[FAULTPHASES];     /* One stop watch per step */
+    double realsecs, cpusecs;
+    int huge;
+    int k;
+
+    testdata=(TestThreadData *)data;
+    locfaultstruct=testdata->control;
+    huge=global_hugepages!=HUGE_OFF && !global_faultsmall;
+
+    testdata->result.iterations=0.0;
+    for(k=0;k<FAULTPHASES;k++)
+        ResetStopWatch(&watch[k]);
+    do {
+        if(fault_cycle(huge,locfaultstruct->arraysize,watch)!=0)
+        {
+            if(!huge)
+            {   ReportError(locfaultstruct->errorcontext,ERROR_MEMORY);
+                ErrorExit();
+            }
+            global_faultsmall=1;
+            huge=0;
+            testdata->result.iterations=0.0;
+            for(k=0;k<FAULTPHASES;k++)
+                ResetStopWatch(&watch[k]);
+            realsecs=(double)0.0;
+            continue;
+        }
+        testdata->result.iterations+=(double)1.0;
+        realsecs=(double)0.0;
+        for(k=0;k<FAULTPHASES;k++)
+            realsecs+=watch[k].realsecs;
+    } while(realsecs<locfaultstruct->request_secs);
+
+    cpusecs=(double)0.0;
+    for(k=0;k<FAULTPHASES;k++)
+        cpusecs+=watch[k].cpusecs;
+    testdata->result.cpusecs=cpusecs;
+    testdata->result.realsecs=realsecs;
+
+    return 0;
+}
+
+/*************
+** FaultRun **
+**************
+** Cycle a region of nbytes on each of threads threads at once,
+** on huge pages if huge is set, for at least secs seconds, and
+** return in ns[] the mean time of every step per 4 KB of the
+** region.  Returns -1 if the pages or the threads can't be had.
+*/
+int FaultRun(int huge, int threads, ulong nbytes, double secs, double *ns)
+{
+    FaultThreadStruct *ft;
+#if defined(LINUX) || defined(OSX)
+    pthread_t *tids;
+#endif
+    double pages;
+    int failed;
+    int i, k;
+
+    ft=(FaultThreadStruct *)malloc(sizeof(FaultThreadStruct)*threads);
+    if(ft==(FaultThreadStruct *)NULL)
+        return(-1);
+#if defined(LINUX) || defined(OSX)
+    tids=(pthread_t *)malloc(sizeof(pthread_t)*threads);
+    if(tids==(pthread_t *)NULL)
+    {   free(ft);
+        return(-1);
+    }
+#else
+    threads=1;
+#endif
+
+    for(i=0;i<threads;i++)
+    {   ft[i].huge=huge;
+        ft[i].nbytes=nbytes;
+        ft[i].secs=secs;
+        ft[i].cycles=(double)0.0;
+        ft[i].failed=0;
+    }
+    fault_go=0;
+#if defined(LINUX) || defined(OSX)
+    for(i=1;i<threads;i++)
+        if(pthread_create(&tids[i],0,fault_thread,&ft[i])!=0)
+            break;
+    for(k=i;k<threads;k++)
+        ft[k].failed=1;
+    pthread_mutex_lock(&fault_lock);
+    fault_go=1;
+    pthread_cond_broadcast(&fault_start);
+    pthread_mutex_unlock(&fault_lock);
+#endif
+    fault_thread(&ft[0]);
+#if defined(LINUX) || defined(OSX)
+    while(--i>0)
+        pthread_join(tids[i],0);
+#endif
+
+    /*
+     ** Sum over the threads, then per 4 KB cycled.
+     */
+    failed=0;
+    pages=(double)0.0;
+    for(k=0;k<FAULTPHASES;k++)
+        ns[k]=(double)0.0;
+    for(i=0;i<threads;i++)
+    {   failed|=ft[i].failed;
+        pages+=ft[i].cycles*(double)(nbytes/OFFSET_PAGE);
+        for(k=0;k<FAULTPHASES;k++)
+            ns[k]+=ft[i].watch[k].realsecs;
+    }
+    for(k=0;k<FAULTPHASES;k++)
+        ns[k]=pages>(double)0.0 ? ns[k]*1e9/pages : (double)0.0;
+
+#if defined(LINUX) || defined(OSX)
+    free(tids);
+#endif
+    free(ft);
+    return(failed ? -1 : 0);
+}
+
+/*****************
+** fault_thread **
+******************
+** One thread of FaultRun(): wait for the start, then cycle
+** until secs is up.
+*/
+static void *fault_thread(void *data)
+{
+    FaultThreadStruct *ft;
+    double realsecs;
+    int k;
+
+    ft=(FaultThreadStruct *)data;
+    for(k=0;k<FAULTPHASES;k++)
+        ResetStopWatch(&ft->watch[k]);
+#if defined(LINUX) || defined(OSX)
+    pthread_mutex_lock(&fault_lock);
+    while(!fault_go)
+        pthread_cond_wait(&fault_start,&fault_lock);
+    pthread_mutex_unlock(&fault_lock);
+#endif
+    do {
+        if(fault_cycle(ft->huge,ft->nbytes,ft->watch)!=0)
+        {   ft->failed=1;
+            break;
+        }
+        ft->cycles+=(double)1.0;
+        realsecs=(double)0.0;
+        for(k=0;k<FAULTPHASES;k++)
+            realsecs+=ft->watch[k].realsecs;
+    } while(realsecs<ft->secs);
+    return 0;
+}
+
+/****************
+** fault_cycle **
+*****************
+** One cycle over a fresh region of nbytes, each step timed on
+** its own stop watch: map it, touch every 4 KB of it, drop the
+** pages with MADV_DONTNEED, touch it again and unmap it.  On
+** huge pages the region is HUGEPAGES' explicit 2 MB pages
+** where that policy is set and pages are reserved, otherwise
+** transparent huge pages on a 2 MB aligned mapping.  Returns
+** -1 if the region can't be mapped, the kernel refuses huge
+** pages, or it won't drop them.
+*/
+static int fault_cycle(int huge, ulong nbytes, StopWatchStruct *watch)
+{
+#ifdef LINUX
+    char *map, *p;
+    size_t maplen;
+    size_t droplen;         /* Bytes MADV_DONTNEED drops */
+    int madv;
+
+    StartStopWatch(&watch[FAULT_MMAP]);
+    map=(char *)MAP_FAILED;
+    if(huge && global_hugepages==HUGE_2M)
+    {   maplen=(size_t)((nbytes+FAULTHUGEPAGE-1)&~(FAULTHUGEPAGE-1));
+        map=(char *)mmap(NULL,maplen,PROT_READ|PROT_WRITE,
+                MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+        p=map;
+
+        /*
+         ** hugetlb only drops whole huge pages.
+         */
+        droplen=maplen;
+    }
+    if(map==(char *)MAP_FAILED)
+    {
+        /*
+         ** Over-map by a huge page so that the region can start
+         ** on a huge page boundary.
+         */
+        maplen=(size_t)(nbytes+(huge ? FAULTHUGEPAGE : 0));
+        map=(char *)mmap(NULL,maplen,PROT_READ|PROT_WRITE,
+                MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+        if(map==(char *)MAP_FAILED)
+        {   StopStopWatch(&watch[FAULT_MMAP]);
+            return(-1);
+        }
+        p=map;
+        droplen=(size_t)nbytes;
+        madv=0;
+#if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+        if(huge)
+        {   p=(char *)(((ulong)map+FAULTHUGEPAGE-1)&~(FAULTHUGEPAGE-1));
+            madv=madvise(p,(size_t)nbytes,MADV_HUGEPAGE);
+        }
+        else
+            madv=madvise(p,(size_t)nbytes,MADV_NOHUGEPAGE);
+#else
+        if(huge) madv=-1;
+#endif
+        if(huge && madv!=0)
+        {   munmap(map,maplen);
+            StopStopWatch(&watch[FAULT_MMAP]);
+            return(-1);
+        }
+    }
+    StopStopWatch(&watch[FAULT_MMAP]);
+
+    StartStopWatch(&watch[FAULT_TOUCH]);
+    touch(p,nbytes);
+    StopStopWatch(&watch[FAULT_TOUCH]);
+
+    StartStopWatch(&watch[FAULT_DONTNEED]);
+    madv=madvise(p,droplen,MADV_DONTNEED);
+    StopStopWatch(&watch[FAULT_DONTNEED]);
+    if(madv!=0)
+    {   munmap(map,maplen);
+        return(-1);
+    }
+
+    StartStopWatch(&watch[FAULT_REFAULT]);
+    touch(p,nbytes);
+    StopStopWatch(&watch[FAULT_REFAULT]);
+
+    StartStopWatch(&watch[FAULT_MUNMAP]);
+    munmap(map,maplen);
+    StopStopWatch(&watch[FAULT_MUNMAP]);
+    return(0);
+#else
+    /*
+     ** Elsewhere, malloc and free stand in for the mapping,
+     ** and nothing gives pages back in between.
+     */
+    char *p;
+
+    if(huge) return(-1);
+    StartStopWatch(&watch[FAULT_MMAP]);
+    p=(char *)malloc((size_t)nbytes);
+    StopStopWatch(&watch[FAULT_MMAP]);
+    if(p==(char *)NULL) return(-1);
+    StartStopWatch(&watch[FAULT_TOUCH]);
+    touch(p,nbytes);
+    StopStopWatch(&watch[FAULT_TOUCH]);
+    StartStopWatch(&watch[FAULT_MUNMAP]);
+    free(p);
+    StopStopWatch(&watch[FAULT_MUNMAP]);
+    return(0);
+#endif
+}
+
+/**********
+** touch **
+***********
+** Write one byte in every 4 KB of the nbytes at p.
+*/
+static void touch(volatile char *p, ulong nbytes)
+{
+    ulong i;
+
+    for(i=0;i<nbytes;i+=OFFSET_PAGE)
+        p[i]=(char)i;
+}
@@ -0,0 +1,126 @@
+
+/*
+** footprint.c
+** Memory footprint and page faults of a test.
+**
+** The peak resident set size comes from VmHWM in
+** /proc/self/status.  The kernel only tracks a lifetime peak,
+** so FootprintBegin() resets it through /proc/self/clear_refs
+** (Linux 4.0 and later); where that fails the peak is the one
+** of the whole run so far.  Faults are those of all threads of
+** the process.  The AllocateMemory() totals are kept by the
+** memory array in sysspec.c.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "sysspec.h"
+#include "footprint.h"
+
+#ifdef LINUX
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+/*
+** Global parameters.
+*/
+int global_footprint;           /* Footprint report requested */
+
+#ifdef LINUX
+
+/*
+** PROTOTYPES
+*/
+static double read_hwm(void);
+
+/*************
+** read_hwm **
+**************
+** Peak resident set size of the process in kB, 0 if unknown.
+*/
+static double read_hwm(void)
+{
+    char line[128];
+    double kb;
+    FILE *fp;
+
+    kb=(double)0.0;
+    fp=fopen("/proc/self/status","r");
+    if(fp==(FILE *)NULL) return(kb);
+    while(fgets(line,sizeof(line),fp)!=NULL)
+        if(sscanf(line,"VmHWM: %lf",&kb)==1)
+            break;
+    fclose(fp);
+    return(kb);
+}
+
+/*******************
+** FootprintBegin **
+********************
+** Take the readings that open a test.
+*/
+void FootprintBegin(FootprintStruct *fp)
+{
+    struct rusage ru;
+    FILE *cr;
+
+    fp->rssreset=0;
+    cr=fopen("/proc/self/clear_refs","w");
+    if(cr!=(FILE *)NULL)
+    {   fp->rssreset=fputs("5",cr)>=0;
+        fp->rssreset=(fclose(cr)==0) && fp->rssreset;
+    }
+
+    getrusage(RUSAGE_SELF,&ru);
+    fp->minflt=ru.ru_minflt;
+    fp->majflt=ru.ru_majflt;
+    fp->allocs=mem_alloc_calls;
+    fp->allocbytes=mem_alloc_bytes;
+    mem_peak_bytes=mem_live_bytes;
+    fp->peakbytes=(double)mem_live_bytes;
+}
+
+/*****************
+** FootprintEnd **
+******************
+** Take the readings that close a test and turn the pair into
+** the test's footprint.  peakbytes counts only the blocks the
+** test allocated itself.
+*/
+void FootprintEnd(FootprintStruct *fp)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF,&ru);
+    fp->minflt=ru.ru_minflt-fp->minflt;
+    fp->majflt=ru.ru_majflt-fp->majflt;
+    fp->allocs=mem_alloc_calls-fp->allocs;
+    fp->allocbytes=mem_alloc_bytes-fp->allocbytes;
+    fp->peakbytes=(double)mem_peak_bytes-fp->peakbytes;
+    fp->peakrss=read_hwm();
+}
+
+#else
+
+/*
+** Elsewhere only the AllocateMemory() totals are known.
+*/
+void FootprintBegin(FootprintStruct *fp)
+{
+    memset(fp,0,sizeof(FootprintStruct));
+    fp->allocs=mem_alloc_calls;
+    fp->allocbytes=mem_alloc_bytes;
+    mem_peak_bytes=mem_live_bytes;
+    fp->peakbytes=(double)mem_live_bytes;
+}
+
+void FootprintEnd(FootprintStruct *fp)
+{
+    fp->allocs=mem_alloc_calls-fp->allocs;
+    fp->allocbytes=mem_alloc_bytes-fp->allocbytes;
+    fp->peakbytes=(double)mem_peak_bytes-fp->peakbytes;
+}
+
+#endif
@@ -0,0 +1,29 @@
+/*
+** footprint.h
+** Header for footprint.c
+** Memory footprint and page faults of a test.
+*/
+
+/*
+** TYPEDEFS
+*/
+typedef struct {
+    double peakrss;         /* Peak resident set in kB */
+    int rssreset;           /* peakrss covers this test only */
+    long minflt;            /* Minor page faults */
+    long majflt;            /* Major page faults */
+    ulong allocs;           /* AllocateMemory() blocks */
+    double allocbytes;      /* Bytes in those blocks */
+    double peakbytes;       /* Most bytes allocated at once */
+} FootprintStruct;
+
+/*
+** EXTERNALS
+*/
+extern int global_footprint;    /* Footprint report requested */
+
+/*
+** PROTOTYPES
+*/
+void FootprintBegin(FootprintStruct *fp);
+void FootprintEnd(FootprintStruct *fp);
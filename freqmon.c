@@ -0,0 +1,288 @@
+
+/*
+** freqmon.c
+** CPU clock and thermal monitoring.
+**
+** Turbo and thermal limits make scores drift from one sample to
+** the next.  These routines read the kernel's cpufreq and thermal
+** interfaces just before and just after each benchmark sample so
+** that every sample can be tagged with the clock it ran at and
+** with whether the CPU was being throttled.  The precise per-thread
+** clock comes from APERF/MPERF (see perfmon.c); the sysfs readings
+** are the fallback and the source of the throttle flag.  The
+** fallback only reads the CPUs the benchmark threads ran on.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "freqmon.h"
+
+#ifdef LINUX
+#include <unistd.h>
+#include <sched.h>
+#endif
+
+/*
+** Global parameters.
+*/
+int global_freqmon;             /* Clock/thermal monitor requested */
+
+#ifdef LINUX
+
+#define CPU_SYSFS "/sys/devices/system/cpu"
+#define THERMAL_SYSFS "/sys/class/thermal"
+
+#define FREQMAXCPUS 1024        /* CPU ids freq_used can hold */
+#define FREQWORDBITS (8*(int)sizeof(unsigned long))
+
+static int freq_ncpus;          /* # of CPU ids to look at */
+
+/*
+** CPUs the benchmark threads were seen on during the current
+** sample, one bit per CPU id; set from the stopwatch.
+*/
+static unsigned long freq_used[FREQMAXCPUS/(8*sizeof(unsigned long))];
+
+/*
+** PROTOTYPES
+*/
+static int read_long(char *path, long *value);
+static double mean_cur_freq(int used);
+static long throttle_count(void);
+static double max_temp(int *hot);
+
+/**************
+** read_long **
+***************
+** Read a single integer from a sysfs file.
+** Returns 0 if ok, -1 if the file can't be read.
+*/
+static int read_long(char *path, long *value)
+{
+    FILE *fp;
+    int n;
+
+    fp=fopen(path,"r");
+    if(fp==(FILE *)NULL) return(-1);
+    n=fscanf(fp,"%ld",value);
+    fclose(fp);
+    return(n==1 ? 0 : -1);
+}
+
+/******************
+** mean_cur_freq **
+*******************
+** Mean of scaling_cur_freq, in kHz, over the CPUs the benchmark
+** threads were seen on if used is set and there are any, else
+** over the CPUs this process may run on.  Idle CPUs elsewhere
+** would only pull the mean down.  Returns 0 if none of them
+** reports a clock.
+*/
+static double mean_cur_freq(int used)
+{
+    char path[128];
+    cpu_set_t allowed;
+    long khz;
+    double sum;
+    int i, n;
+
+    if(used)
+    {   used=0;
+        for(i=0;i<freq_ncpus && i<FREQMAXCPUS;i++)
+            if(freq_used[i/FREQWORDBITS]&(1UL<<(i%FREQWORDBITS)))
+                used=1;
+    }
+    if(sched_getaffinity(0,sizeof(allowed),&allowed)!=0)
+        CPU_ZERO(&allowed);
+
+    sum=(double)0.0;
+    n=0;
+    for(i=0;i<freq_ncpus;i++)
+    {
+        if(used)
+        {   if(i>=FREQMAXCPUS ||
+                    !(freq_used[i/FREQWORDBITS]&(1UL<<(i%FREQWORDBITS))))
+                continue;
+        }
+        else if(CPU_COUNT(&allowed)>0 && i<CPU_SETSIZE &&
+                !CPU_ISSET(i,&allowed))
+            continue;
+        sprintf(path,CPU_SYSFS "/cpu%d/cpufreq/scaling_cur_freq",i);
+        if(read_long(path,&khz)==0 && khz>0)
+        {   sum+=(double)khz;
+            n++;
+        }
+    }
+    return(n ? sum/(double)n : (double)0.0);
+}
+
+/*******************
+** throttle_count **
+********************
+** Total thermal throttle events (core and package) reported
+** by the CPUs.  Only Intel CPUs publish these.
+*/
+static long throttle_count(void)
+{
+    char path[128];
+    long count, total;
+    int i;
+
+    total=0;
+    for(i=0;i<freq_ncpus;i++)
+    {
+        sprintf(path,CPU_SYSFS "/cpu%d/thermal_throttle/core_throttle_count",i);
+        if(read_long(path,&count)==0) total+=count;
+        sprintf(path,CPU_SYSFS "/cpu%d/thermal_throttle/package_throttle_count",i);
+        if(read_long(path,&count)==0) total+=count;
+    }
+    return(total);
+}
+
+/*************
+** max_temp **
+**************
+** Temperature of the hottest thermal zone, in deg C.  Sets
+** *hot if any zone is at or above one of its passive (clock
+** throttling) or hot trip points.  Returns 0 if no zone can
+** be read.
+*/
+static double max_temp(int *hot)
+{
+    char path[128];
+    char type[32];
+    long temp, trip;
+    double hottest;
+    int zone, t;
+    FILE *fp;
+
+    hottest=(double)0.0;
+    *hot=0;
+    for(zone=0;;zone++)
+    {
+        sprintf(path,THERMAL_SYSFS "/thermal_zone%d/temp",zone);
+        if(read_long(path,&temp)) break;
+        if((double)temp/1000.0>hottest) hottest=(double)temp/1000.0;
+
+        for(t=0;;t++)
+        {
+            sprintf(path,THERMAL_SYSFS "/thermal_zone%d/trip_point_%d_type",zone,t);
+            fp=fopen(path,"r");
+            if(fp==(FILE *)NULL) break;
+            if(fscanf(fp,"%31s",type)!=1) type[0]='\0';
+            fclose(fp);
+            if(strcmp(type,"passive")!=0 && strcmp(type,"hot")!=0)
+                continue;
+            sprintf(path,THERMAL_SYSFS "/thermal_zone%d/trip_point_%d_temp",zone,t);
+            if(read_long(path,&trip)==0 && trip>0 && temp>=trip)
+                *hot=1;
+        }
+    }
+    return(hottest);
+}
+
+/*************
+** FreqInit **
+**************
+** Check which clock and thermal interfaces this host has.
+** Returns 0 if at least one is readable, -1 if none is; in
+** that case reason holds a short explanation.
+*/
+int FreqInit(char *reason)
+{
+    int hot;
+
+    freq_ncpus=(int)sysconf(_SC_NPROCESSORS_CONF);
+    if(freq_ncpus<1) freq_ncpus=1;
+
+    if(mean_cur_freq(0)>(double)0.0 || max_temp(&hot)>(double)0.0)
+        return(0);
+    strcpy(reason,"no cpufreq or thermal zone information");
+    return(-1);
+}
+
+/*****************
+** FreqCheckCpu **
+******************
+** Called by the benchmark threads from the stopwatch; notes
+** the CPU the calling thread is on.
+*/
+void FreqCheckCpu(void)
+{
+    int cpu;
+
+    if(!global_freqmon) return;
+    cpu=sched_getcpu();
+    if(cpu>=0 && cpu<FREQMAXCPUS)
+        __sync_fetch_and_or(&freq_used[cpu/FREQWORDBITS],
+                1UL<<(cpu%FREQWORDBITS));
+}
+
+/********************
+** FreqSampleBegin **
+*********************
+** Take the readings that open a sample.  The benchmark threads
+** don't run yet, so the clock is read over every CPU they may
+** run on.
+*/
+void FreqSampleBegin(FreqSampleStruct *fs)
+{
+    memset(freq_used,0,sizeof(freq_used));
+    fs->khz=mean_cur_freq(0);
+    fs->temp=max_temp(&fs->throttled);
+    fs->throttle=throttle_count();
+}
+
+/******************
+** FreqSampleEnd **
+*******************
+** Take the readings that close a sample and combine them with
+** the opening ones: the clock is the mean of both readings,
+** the temperature the higher one.  The sample is flagged as
+** throttled if the CPUs logged throttle events meanwhile or a
+** thermal zone sat at a throttling trip point at either end.
+*/
+void FreqSampleEnd(FreqSampleStruct *fs)
+{
+    double khz, temp;
+    int hot;
+
+    khz=mean_cur_freq(1);
+    if(fs->khz>(double)0.0 && khz>(double)0.0)
+        fs->khz=(fs->khz+khz)/(double)2.0;
+    else if(khz>(double)0.0)
+        fs->khz=khz;
+
+    temp=max_temp(&hot);
+    if(temp>fs->temp) fs->temp=temp;
+    fs->throttle=throttle_count()-fs->throttle;
+    fs->throttled=fs->throttled || hot || fs->throttle>0;
+}
+
+#else
+
+/*
+** Elsewhere there is nothing to read.
+*/
+int FreqInit(char *reason)
+{
+    strcpy(reason,"not supported on this system");
+    return(-1);
+}
+
+void FreqCheckCpu(void)
+{
+}
+
+void FreqSampleBegin(FreqSampleStruct *fs)
+{
+    memset(fs,0,sizeof(FreqSampleStruct));
+}
+
+void FreqSampleEnd(FreqSampleStruct *fs)
+{
+}
+
+#endif
@@ -0,0 +1,28 @@
+/*
+** freqmon.h
+** Header for freqmon.c
+** CPU clock and thermal monitoring around benchmark samples.
+*/
+
+/*
+** TYPEDEFS
+*/
+typedef struct {
+    double khz;             /* Mean scaling_cur_freq of the threads' CPUs, 0 if unknown */
+    double temp;            /* Hottest thermal zone in deg C, 0 if unknown */
+    long throttle;          /* Thermal throttle events seen by the CPUs */
+    int throttled;          /* Sample ran while the CPU was throttled */
+} FreqSampleStruct;
+
+/*
+** EXTERNALS
+*/
+extern int global_freqmon;      /* Clock/thermal monitor requested */
+
+/*
+** PROTOTYPES
+*/
+int FreqInit(char *reason);
+void FreqCheckCpu(void);
+void FreqSampleBegin(FreqSampleStruct *fs);
+void FreqSampleEnd(FreqSampleStruct *fs);
@@ -1,9 +1,17 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include "hardware.h"
 
 #define BUF_SIZ 1024
 
+#define CPU_SYSFS "/sys/devices/system/cpu"
+#define NODE_SYSFS "/sys/devices/system/node"
+#define MAXCPUS 4096                  /* CPU ids looked at */
+
+static TopologyStruct topology;       /* Filled in on first use */
+static int topology_read;
+
 /******************
 ** output_string **
 *******************
@@ -155,12 +163,333 @@ static void readProcCpuInfo (char *model, char *cache) {
 }
 
 
+/**************
+** readSysfs **
+***************
+** Reads the first line of a sysfs file into result (at most
+** len bytes, newline removed).  Returns 0 if ok, -1 if the
+** file can't be read.
+*/
+static int readSysfs (const char *path, char *result, int len) {
+  FILE * fp;
+
+  fp = fopen(path, "r");
+  if(fp == NULL) {
+    return -1;
+  }
+  if(NULL == fgets(result, len, fp)) {
+    fclose(fp);
+    return -1;
+  }
+  fclose(fp);
+  removeNewLine(result);
+  return 0;
+}
+
+
+/**************
+** countList **
+***************
+** Counts the CPUs in a sysfs CPU list such as "0-3,8-11".
+*/
+static int countList (const char *list) {
+  int count = 0;
+  long first, last;
+  char * cp;
+
+  while(*list != '\0') {
+    first = strtol(list, &cp, 10);
+    if(cp == list) {
+      break;
+    }
+    last = first;
+    if(*cp == '-') {
+      list = cp + 1;
+      last = strtol(list, &cp, 10);
+    }
+    count += (int)(last - first + 1);
+    list = cp;
+    if(*list == ',') {
+      list++;
+    }
+  }
+  return count;
+}
+
+
+/***************
+** readCaches **
+****************
+** Reads the cache descriptions of CPU 0 into topo.
+*/
+static void readCaches (TopologyStruct *topo) {
+  char path[128];
+  char buffer[BUF_SIZ];
+  CacheInfoStruct * c;
+  char * cp;
+  int i;
+
+  topo->ncaches = 0;
+  for(i = 0; i < MAXCACHES; i++) {
+    sprintf(path, CPU_SYSFS "/cpu0/cache/index%d/size", i);
+    if(readSysfs(path, buffer, BUF_SIZ)) {
+      break;
+    }
+    c = &topo->cache[topo->ncaches++];
+    memset(c, 0, sizeof(CacheInfoStruct));
+    c->size = strtoul(buffer, &cp, 10);
+    if(*cp == 'K') {
+      c->size <<= 10;
+    } else if(*cp == 'M') {
+      c->size <<= 20;
+    }
+    sprintf(path, CPU_SYSFS "/cpu0/cache/index%d/level", i);
+    if(0 == readSysfs(path, buffer, BUF_SIZ)) {
+      c->level = atoi(buffer);
+    }
+    sprintf(path, CPU_SYSFS "/cpu0/cache/index%d/type", i);
+    if(0 == readSysfs(path, buffer, BUF_SIZ)) {
+      sprintf(c->type, "%.15s", buffer);
+    }
+    sprintf(path, CPU_SYSFS "/cpu0/cache/index%d/ways_of_associativity", i);
+    if(0 == readSysfs(path, buffer, BUF_SIZ)) {
+      c->ways = atoi(buffer);
+    }
+    sprintf(path, CPU_SYSFS "/cpu0/cache/index%d/coherency_line_size", i);
+    if(0 == readSysfs(path, buffer, BUF_SIZ)) {
+      c->line = atoi(buffer);
+    }
+    sprintf(path, CPU_SYSFS "/cpu0/cache/index%d/shared_cpu_list", i);
+    if(0 == readSysfs(path, buffer, BUF_SIZ)) {
+      c->sharing = countList(buffer);
+    }
+  }
+}
+
+
+/*************
+** llcIndex **
+**************
+** Index in topo->cache of the last level cache, -1 if none.
+*/
+static int llcIndex (const TopologyStruct *topo) {
+  int i, best = -1, level = 0;
+
+  for(i = 0; i < topo->ncaches; i++) {
+    if(strcmp(topo->cache[i].type, "Instruction") != 0 &&
+       topo->cache[i].level >= level) {
+      level = topo->cache[i].level;
+      best = i;
+    }
+  }
+  return best;
+}
+
+
+/*****************
+** readTopology **
+******************
+** Counts CPUs, cores, packages, last level caches and NUMA
+** nodes into topo.  A core is a distinct (package, core id)
+** pair, a last level cache a distinct lowest CPU among those
+** sharing it.  Nodes are counted from the online node list,
+** whose ids need not be contiguous.  Needs the caches read.
+*/
+static void readTopology (TopologyStruct *topo) {
+  char path[128];
+  char buffer[BUF_SIZ];
+  long * pkgs;
+  long * corekeys;
+  long * llckeys;
+  long pkg, core, llc;
+  int cpu, i, llcindex;
+
+  topo->cpus = topo->cores = topo->packages = topo->smt = topo->nodes = 0;
+  topo->llcs = 0;
+  llcindex = llcIndex(topo);
+  pkgs = (long *)malloc(MAXCPUS * sizeof(long));
+  corekeys = (long *)malloc(MAXCPUS * sizeof(long));
+  llckeys = (long *)malloc(MAXCPUS * sizeof(long));
+  if(pkgs == NULL || corekeys == NULL || llckeys == NULL) {
+    free(pkgs);
+    free(corekeys);
+    free(llckeys);
+    return;
+  }
+  for(cpu = 0; cpu < MAXCPUS; cpu++) {
+    sprintf(path, CPU_SYSFS "/cpu%d/topology/physical_package_id", cpu);
+    if(readSysfs(path, buffer, BUF_SIZ)) {
+      /* offline CPUs have no topology; stop at the first gap */
+      sprintf(path, CPU_SYSFS "/cpu%d/online", cpu);
+      if(readSysfs(path, buffer, BUF_SIZ)) {
+        break;
+      }
+      continue;
+    }
+    pkg = atol(buffer);
+    sprintf(path, CPU_SYSFS "/cpu%d/topology/core_id", cpu);
+    core = readSysfs(path, buffer, BUF_SIZ) ? (long)cpu : atol(buffer);
+    topo->cpus++;
+    for(i = 0; i < topo->packages && pkgs[i] != pkg; i++)
+      ;
+    if(i == topo->packages) {
+      pkgs[topo->packages++] = pkg;
+    }
+    for(i = 0; i < topo->cores && corekeys[i] != pkg * 65536L + core; i++)
+      ;
+    if(i == topo->cores) {
+      corekeys[topo->cores++] = pkg * 65536L + core;
+    }
+    if(llcindex >= 0) {
+      sprintf(path, CPU_SYSFS "/cpu%d/cache/index%d/shared_cpu_list", cpu, llcindex);
+      llc = readSysfs(path, buffer, BUF_SIZ) ? (long)cpu : atol(buffer);
+      for(i = 0; i < topo->llcs && llckeys[i] != llc; i++)
+        ;
+      if(i == topo->llcs) {
+        llckeys[topo->llcs++] = llc;
+      }
+    }
+  }
+  free(pkgs);
+  free(corekeys);
+  free(llckeys);
+  if(topo->cores > 0) {
+    topo->smt = topo->cpus / topo->cores;
+  }
+
+  if(0 == readSysfs(NODE_SYSFS "/online", buffer, BUF_SIZ)) {
+    topo->nodes = countList(buffer);
+  }
+}
+
+
+/*********************
+** HardwareTopology **
+**********************
+** Caches and topology of the host, read from sysfs on the
+** first call.
+*/
+const TopologyStruct *HardwareTopology(void) {
+  if(!topology_read) {
+    readCaches(&topology);
+    readTopology(&topology);
+    topology_read = 1;
+  }
+  return &topology;
+}
+
+
+/**************
+** CacheSize **
+***************
+** Size in bytes of the data (or unified) cache at level,
+** 0 if there is none or it is unknown.
+*/
+unsigned long CacheSize(int level) {
+  const TopologyStruct * topo = HardwareTopology();
+  int i;
+
+  for(i = 0; i < topo->ncaches; i++) {
+    if(topo->cache[i].level == level &&
+       strcmp(topo->cache[i].type, "Instruction") != 0) {
+      return topo->cache[i].size;
+    }
+  }
+  return 0;
+}
+
+
+/************
+** LLCSize **
+*************
+** Size in bytes of the last level cache, 0 if unknown.
+*/
+unsigned long LLCSize(void) {
+  const TopologyStruct * topo = HardwareTopology();
+  int i;
+
+  i = llcIndex(topo);
+  return i < 0 ? 0UL : topo->cache[i].size;
+}
+
+
+/***************
+** LLCDomains **
+****************
+** Number of separate last level caches (each of LLCSize()
+** bytes), at least 1.  Threads spread over n of them can hold
+** n times LLCSize() between them.
+*/
+int LLCDomains(void) {
+  const TopologyStruct * topo = HardwareTopology();
+
+  return topo->llcs > 0 ? topo->llcs : 1;
+}
+
+
+/**************
+** CacheLine **
+***************
+** Line size in bytes of the level 1 data cache, 64 if unknown.
+*/
+int CacheLine(void) {
+  const TopologyStruct * topo = HardwareTopology();
+  int i;
+
+  for(i = 0; i < topo->ncaches; i++) {
+    if(topo->cache[i].level == 1 && topo->cache[i].line > 0 &&
+       strcmp(topo->cache[i].type, "Instruction") != 0) {
+      return topo->cache[i].line;
+    }
+  }
+  return 64;
+}
+
+
+/*****************
+** showTopology **
+******************
+** Writes one line per cache and one for the topology.
+*/
+static void showTopology (const int write_to_file, FILE *global_ofile) {
+  const TopologyStruct * topo = HardwareTopology();
+  const CacheInfoStruct * c;
+  char buffer[BUF_SIZ];
+  char name[24];
+  char size[32];
+  int i;
+
+  for(i = 0; i < topo->ncaches; i++) {
+    c = &topo->cache[i];
+    sprintf(name, "L%d%s Cache", c->level,
+            strcmp(c->type, "Data") == 0 ? "d" :
+            strcmp(c->type, "Instruction") == 0 ? "i" : "");
+    if(c->size >= (1UL<<20) && c->size % (1UL<<20) == 0) {
+      sprintf(size, "%lu MB", c->size >> 20);
+    } else {
+      sprintf(size, "%lu KB", c->size >> 10);
+    }
+    sprintf(buffer, "%-20s: %s, %d-way, %d B lines, shared by %d CPU%s\n",
+            name, size, c->ways, c->line, c->sharing, c->sharing == 1 ? "" : "s");
+    output_string(buffer, write_to_file, global_ofile);
+  }
+  if(topo->cpus > 0) {
+    sprintf(buffer, "Topology            : %d CPU%s, %d core%s, %d package%s, %d thread%s/core, %d NUMA node%s, %d LLC%s\n",
+            topo->cpus, topo->cpus == 1 ? "" : "s", topo->cores, topo->cores == 1 ? "" : "s", topo->packages, topo->packages == 1 ? "" : "s",
+            topo->smt, topo->smt == 1 ? "" : "s", topo->nodes, topo->nodes == 1 ? "" : "s",
+            topo->llcs, topo->llcs == 1 ? "" : "s");
+    output_string(buffer, write_to_file, global_ofile);
+  }
+}
+
+
 /*************
 ** hardware **
 **************
 ** Runs the system command "uname -s -r"
 ** Reads /proc/cpuinfo if on a linux system
-** Writes output
+** Writes output, with the caches and topology from sysfs
+** where it has them (else the /proc/cpuinfo cache size)
 */
 void hardware(const int write_to_file, FILE *global_ofile) {
   char buffer[BUF_SIZ];
@@ -181,8 +510,12 @@ void hardware(const int write_to_file, FILE *global_ofile) {
   }
   sprintf(buffer, "CPU                 : %s\n", model);
   output_string(buffer, write_to_file, global_ofile);
-  sprintf(buffer, "L2 Cache            : %s\n", cache);
-  output_string(buffer, write_to_file, global_ofile);
+  if(HardwareTopology()->ncaches > 0) {
+    showTopology(write_to_file, global_ofile);
+  } else {
+    sprintf(buffer, "L2 Cache            : %s\n", cache);
+    output_string(buffer, write_to_file, global_ofile);
+  }
   sprintf(buffer, "OS                  : %s\n", os);
   output_string(buffer, write_to_file, global_ofile);
 }
@@ -1,2 +1,48 @@
+/*
+** hardware.h
+** Header for hardware.c
+** Host description: OS, CPU, caches and topology.
+*/
+
+#define MAXCACHES 8             /* Cache descriptions kept */
+
+/*
+** One cache of CPU 0, as published in
+** /sys/devices/system/cpu/cpu0/cache/index*.
+*/
+typedef struct {
+  int level;                    /* 1, 2, 3... */
+  char type[16];                /* Data, Instruction or Unified */
+  unsigned long size;           /* Bytes */
+  int ways;                     /* Associativity, 0 if unknown */
+  int line;                     /* Line size in bytes, 0 if unknown */
+  int sharing;                  /* # of CPUs sharing it */
+} CacheInfoStruct;
+
+/*
+** Caches and topology of the host.  Counts are 0 where sysfs
+** does not say.
+*/
+typedef struct {
+  int ncaches;
+  CacheInfoStruct cache[MAXCACHES];
+  int cpus;                     /* Logical CPUs */
+  int cores;                    /* Physical cores */
+  int packages;                 /* Sockets */
+  int smt;                      /* Threads per core */
+  int nodes;                    /* NUMA nodes */
+  int llcs;                     /* Last level caches (domains) */
+} TopologyStruct;
+
 extern
 void hardware(const int write_to_file, FILE *global_ofile);
+extern
+const TopologyStruct *HardwareTopology(void);
+extern
+unsigned long CacheSize(int level);
+extern
+unsigned long LLCSize(void);
+extern
+int LLCDomains(void);
+extern
+int CacheLine(void);
@@ -84,6 +84,7 @@ void *HuffmanFunc(void *data);
 static void create_text_line(farchar *dt,long nchars);
 static void create_text_block(farchar *tb, ulong tblen,
 		ushort maxlinlen);
+static void fill_text_block(void *arg, ulong first, ulong last);
 static void DoHuffIteration(farchar *plaintext,
 	farchar *comparray, farchar *decomparray,
 	ulong arraysize, ulong nloops, huff_node *hufftree, StopWatchStruct *stopwatch);
@@ -181,8 +182,12 @@ void HuffDataSetup(TestControlStruct *lochuffstruct, HuffData *huffdata)
      ** Reset random number generator so things repeat.
      ** added by Uwe F. Mayer
      */
-    randnum((int32)13);
-    create_text_block(huffdata->plaintext,lochuffstruct->arraysize-1,(ushort)500);
+    randdata();
+    if(global_randgen==RAND_SPLITMIX)
+        RandParallel(fill_text_block,(void *)huffdata->plaintext,
+                lochuffstruct->arraysize-1);
+    else
+        create_text_block(huffdata->plaintext,lochuffstruct->arraysize-1,(ushort)500);
     huffdata->plaintext[lochuffstruct->arraysize-1L]='\0';
 }
 
@@ -380,6 +385,32 @@ static void create_text_block(farchar *tb,
 
 }
 
+/********************
+** fill_text_block **
+*********************
+** RandParallel() part of the plaintext with RANDGEN=SPLITMIX:
+** bytes first to last-1 of the text at arg.  The text is made
+** of blocks of RANDPARCHUNK bytes built by create_text_block()
+** one by one, each from its own stretch of the random numbers.
+** A block never takes more numbers than it has bytes, so block
+** b starts its stretch at number b*RANDPARCHUNK+1.
+*/
+static void fill_text_block(void *arg,
+            ulong first,
+            ulong last)
+{
+    farchar *tb;            /* Text to fill */
+    ulong blocklen;         /* Bytes in this block */
+
+    tb=(farchar *)arg;
+    for(;first<last;first+=blocklen)
+    {
+        blocklen=last-first<RANDPARCHUNK ? last-first : RANDPARCHUNK;
+        randseek(first+1L);
+        create_text_block(tb+first,blocklen,(ushort)500);
+    }
+}
+
 /********************
 ** DoHuffIteration **
 *********************
@@ -573,6 +604,7 @@ static void DoHuffIteration(farchar *plaintext,
 #endif
             textoffset++;
         } while(bitoffset<maxbitoffset);
+        OPCOUNT_ADD(OP_BITS,maxbitoffset);
 
     }       /* End the big while(nloops--) from above */
 
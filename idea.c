@@ -515,6 +515,7 @@ static void cipher_idea(u16 in[4],
        register u16 t32; */
     int r=ROUNDS;
 
+    OPCOUNT_ADD(OP_BLOCKS,1);
     x1=*in++;
     x2=*in++;
     x3=*in++;
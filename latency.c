@@ -0,0 +1,217 @@
+
+/*
+** latency.c
+** Memory latency test.
+**
+** A chain of pointers, one per cache line, is laid through a
+** buffer in a random cyclic order and followed load by load.
+** Each load needs the address the previous one returned and
+** the order defeats the prefetchers, so the time per load is
+** the latency of whichever level of the memory hierarchy the
+** buffer fits in.  The scored test follows a chain larger than
+** any cache; LatencyNs() times one chain of any size, which
+** the report uses to sweep from L1 out to DRAM, on normal and
+** on huge pages.  The score is loads per second; it does not
+** count toward the legacy indexes.
+*/
+
+/*
+** INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "sysspec.h"
+#include "misc.h"
+
+#ifdef LINUX
+#include <sys/mman.h>
+#endif
+
+/*
+** Largest buffer the report sweeps to, bytes.
+*/
+ulong global_latencymax;
+
+/*
+** Keeps the chasing loop from being optimized away.
+*/
+static void *volatile latency_sink;
+
+/*
+** PROTOTYPES
+*/
+void DoLatency(void);
+static void *LatencyFunc(void *data);
+static void **build_chain(ulong nbytes, ulong seed, int *systemerror);
+static void **chase(void **p, ulong nloads);
+
+/**************
+** DoLatency **
+***************
+** Perform the memory latency test.  There is nothing to
+** adjust; every iteration is one load.
+*/
+void DoLatency(void)
+{
+    TestControlStruct *loclatencystruct;  /* Local latency structure */
+
+    loclatencystruct=&global_latencystruct;
+    loclatencystruct->adjust=1;
+
+    run_bench_with_concurrency(loclatencystruct, LatencyFunc);
+}
+
+/****************
+** LatencyFunc **
+*****************
+** Body of one latency thread: build a chain of its own and
+** follow it until the requested time is up.
+*/
+static void *LatencyFunc(void *data)
+{
+    TestThreadData *testdata;       /* test data passed from thread func */
+    TestControlStruct *loclatencystruct;    /* Local pointer to global struct */
+    StopWatchStruct stopwatch;      /* Stop watch to time the test */
+    void **chain, **p;
+    int systemerror;                /* For holding error code */
+
+    testdata=(TestThreadData *)data;
+    loclatencystruct=testdata->control;
+
+    chain=build_chain(loclatencystruct->arraysize,loclatencystruct->arraysize,
+            &systemerror);
+    if(systemerror)
+    {
+        ReportError(loclatencystruct->errorcontext,systemerror);
+        ErrorExit();
+    }
+
+    /*
+     ** One untimed lap (or chunk) to fill the caches and TLB.
+     */
+    p=chase(chain,loclatencystruct->arraysize/LATENCYLINE<LATENCYCHUNK ?
+            loclatencystruct->arraysize/LATENCYLINE : LATENCYCHUNK);
+
+    testdata->result.iterations=0.0;
+    ResetStopWatch(&stopwatch);
+    do {
+        StartStopWatch(&stopwatch);
+        p=chase(p,LATENCYCHUNK);
+        StopStopWatch(&stopwatch);
+        testdata->result.iterations+=(double)LATENCYCHUNK;
+    } while(stopwatch.realsecs<loclatencystruct->request_secs);
+    latency_sink=p;
+
+    FreeMemory((farvoid *)chain,&systemerror);
+
+    testdata->result.cpusecs=stopwatch.cpusecs;
+    testdata->result.realsecs=stopwatch.realsecs;
+
+    return 0;
+}
+
+/**************
+** LatencyNs **
+***************
+** Build a chain over nbytes, under the current page policy,
+** and return the mean time per load in ns, following it for
+** at least secs seconds.  Returns a negative value if the
+** buffer can't be allocated.
+*/
+double LatencyNs(ulong nbytes, double secs)
+{
+    StopWatchStruct stopwatch;      /* Stop watch to time the chain */
+    void **chain, **p;
+    double loads;
+    int systemerror;
+
+    chain=build_chain(nbytes,nbytes,&systemerror);
+    if(systemerror)
+        return((double)-1.0);
+
+    p=chase(chain,nbytes/LATENCYLINE<LATENCYCHUNK ?
+            nbytes/LATENCYLINE : LATENCYCHUNK);
+    loads=(double)0.0;
+    ResetStopWatch(&stopwatch);
+    do {
+        StartStopWatch(&stopwatch);
+        p=chase(p,LATENCYCHUNK/4);
+        StopStopWatch(&stopwatch);
+        loads+=(double)(LATENCYCHUNK/4);
+    } while(stopwatch.realsecs<secs);
+    latency_sink=p;
+
+    FreeMemory((farvoid *)chain,&systemerror);
+    return(stopwatch.realsecs/loads*1e9);
+}
+
+/****************
+** build_chain **
+*****************
+** Allocate nbytes and link its cache lines into one random
+** cycle (Sattolo's shuffle), the first word of each line
+** pointing at the next line to visit.  seed picks the order;
+** the benchmark's own generator is too short-periodic for
+** millions of lines and is not thread safe, so a xorshift
+** generator is used here.  Returns the start of the chain.
+*/
+static void **build_chain(ulong nbytes, ulong seed, int *systemerror)
+{
+    char *buf;
+    void *t;
+    ulong nlines, i, j;
+    unsigned long long x;
+
+    nlines=nbytes/LATENCYLINE;
+    if(nlines<2) nlines=2;
+    buf=(char *)AllocateMemory(nlines*LATENCYLINE,systemerror);
+    if(*systemerror)
+        return((void **)NULL);
+
+#if defined(LINUX) && defined(MADV_NOHUGEPAGE)
+    /*
+     ** Normal pages really are normal pages, even where
+     ** transparent huge pages are on for everything.
+     */
+    if(global_hugepages==HUGE_OFF && nlines*LATENCYLINE>=HUGE_MINBYTES)
+    {   i=((ulong)buf+OFFSET_PAGE-1)&~(ulong)(OFFSET_PAGE-1);
+        madvise((void *)i,(size_t)((nlines*LATENCYLINE-(i-(ulong)buf))&
+                ~(ulong)(OFFSET_PAGE-1)),MADV_NOHUGEPAGE);
+    }
+#endif
+
+    for(i=0;i<nlines;i++)
+        *(void **)(buf+i*LATENCYLINE)=(void *)(buf+i*LATENCYLINE);
+
+    x=(unsigned long long)seed*0x9E3779B97F4A7C15ULL|1ULL;
+    for(i=nlines-1;i>0;i--)
+    {
+        x^=x<<13;
+        x^=x>>7;
+        x^=x<<17;
+        j=(ulong)(x%(unsigned long long)i);
+        t=*(void **)(buf+i*LATENCYLINE);
+        *(void **)(buf+i*LATENCYLINE)=*(void **)(buf+j*LATENCYLINE);
+        *(void **)(buf+j*LATENCYLINE)=t;
+    }
+    return((void **)buf);
+}
+
+/**********
+** chase **
+***********
+** Follow the chain from p for nloads loads (a multiple of 8)
+** and return where it stopped.
+*/
+static void **chase(void **p, ulong nloads)
+{
+    ulong i;
+
+    for(i=0;i<nloads;i+=8)
+    {   p=(void **)*p; p=(void **)*p; p=(void **)*p; p=(void **)*p;
+        p=(void **)*p; p=(void **)*p; p=(void **)*p; p=(void **)*p;
+    }
+    return(p);
+}
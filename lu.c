@@ -378,10 +378,9 @@ static void DoLUIteration(fardouble *a,fardouble *b,
     {
         locabase=abase+j*LUARRAYROWS*LUARRAYCOLS;
         locbbase=bbase+j*LUARRAYROWS;
-        for(i=0;i<LUARRAYROWS*LUARRAYCOLS;i++)
-            *(locabase+i)=*(a+i);
-        for(i=0;i<LUARRAYROWS;i++)
-            *(locbbase+i)=*(b+i);
+        memcpy((void *)locabase,(void *)a,
+                sizeof(double)*LUARRAYROWS*LUARRAYCOLS);
+        memcpy((void *)locbbase,(void *)b,sizeof(double)*LUARRAYROWS);
     }
 
     /*
@@ -420,7 +419,7 @@ static void build_problem(double a[][LUARRAYCOLS],
      ** Reset random number generator
      */
     /* randnum(13L); */
-    randnum((int32)13);
+    randdata();
 
     /*
      ** Build an identity matrix.
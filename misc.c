@@ -19,19 +19,39 @@
 ** this code.
 */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include "nmglobal.h"
 #include "misc.h"
+#include "perfmon.h"
+#include "profile.h"
+#include "trace.h"
 
 #if defined(LINUX) || defined(OSX)
 #include <pthread.h>
 #include "sysspec.h"
 #endif
 
+#ifdef LINUX
+#include <string.h>
+#include <sched.h>
+#include <dirent.h>
+#endif
+
 /***********************************************************
 **     MISCELLANEOUS BUT OTHERWISE NECESSARY ROUTINES     **
 ***********************************************************/
 
+int global_freshdata;           /* New input data every iteration */
+int global_randgen;             /* Generator of input data (RAND_xxx) */
+int global_initthreads;         /* Threads RandParallel() may use */
+
+#ifdef OPCOUNT
+int global_opcount_on;          /* Operation counting enabled */
+__thread int opcount_timed;     /* Counting in this thread's timed region */
+__thread unsigned long opcount[NUMOPKINDS];     /* This thread's counts */
+#endif
+
 /****************************
 ** RANDOM NUMBER GENERATOR **
 *****************************
@@ -39,8 +59,45 @@
 ** generator.  Its advantage is (of course) that it can be
 ** seeded and will thus produce repeatable sequences of
 ** random numbers.
+** With RANDGEN=SPLITMIX the numbers come from SplitMix64
+** instead, a counter-based generator: draw k of a data set is
+** a hash of k, so randseek() can start anywhere and pieces of
+** one data set can be generated apart, see RandParallel().
+** Every thread has its own state, so threads building their
+** data at the same time all get the same data.
 */
 
+#if defined(LINUX) || defined(OSX)
+#define RANDSTATE static __thread
+#else
+#define RANDSTATE static
+#endif
+
+#define SPLITMIX_GAMMA 0x9E3779B97F4A7C15ULL
+
+RANDSTATE int32 randw[2] = { (int32)13 , (int32)117 };
+RANDSTATE int32 randepoch;      /* Data sets built so far (FRESHDATA) */
+RANDSTATE unsigned long long randbase;   /* SplitMix64: data set start */
+RANDSTATE unsigned long long randstate;  /* SplitMix64: counter */
+
+/*
+** Work of one RandParallel() helper.
+*/
+typedef struct {
+    void (*fill)(void *arg, ulong first, ulong last);
+    void *arg;
+    ulong first, last;              /* Elements to fill */
+    unsigned long long base;        /* Caller's data set */
+    int started;                    /* Has a thread of its own */
+} RandPartStruct;
+
+#if defined(LINUX) || defined(OSX)
+static void *rand_part(void *data);
+#endif
+#ifdef LINUX
+static int rand_nodecpus(cpu_set_t *set);
+#endif
+
 /****************************
 *         randwc()          *
 *****************************
@@ -113,7 +170,22 @@ long randnum(long lngval)
 int32 randnum(int32 lngval)
 {
     register int32 interm;
-    static int32 randw[2] = { (int32)13 , (int32)117 };
+    unsigned long long z;
+
+    if(global_randgen==RAND_SPLITMIX)
+    {
+        /*
+         ** Same range as the LCG, so every test's data keeps
+         ** its distribution.
+         */
+        if (lngval!=(int32)0)
+            randstate=randbase=(unsigned long long)13*SPLITMIX_GAMMA;
+        z=(randstate+=SPLITMIX_GAMMA);
+        z=(z^(z>>30))*0xBF58476D1CE4E5B9ULL;
+        z=(z^(z>>27))*0x94D049BB133111EBULL;
+        z^=z>>31;
+        return((int32)(z%(unsigned long long)999563));
+    }
 
     if (lngval!=(int32)0)
     {   randw[0]=(int32)13; randw[1]=(int32)117; }
@@ -124,6 +196,229 @@ int32 randnum(int32 lngval)
     return(interm);
 }
 
+/****************************
+*        randdata()         *
+*****************************
+** Restart the generator before building a set of input data.
+** This is randnum(13), so every iteration gets the same data,
+** unless FRESHDATA is set; then every call starts a different
+** sequence.
+*/
+void randdata(void)
+{
+    randnum((int32)13);
+    if(global_freshdata)
+    {   randepoch++;
+        randw[0]=(int32)((13L+(long)randepoch*7919L)%999563L);
+        randbase=(unsigned long long)(13L+(long)randepoch*7919L)*SPLITMIX_GAMMA;
+        randstate=randbase+SPLITMIX_GAMMA;
+    }
+}
+
+/****************************
+*        randseek()         *
+*****************************
+** With RANDGEN=SPLITMIX, make the next randnum((int32)0) return
+** draw number index of the current data set, counting the draw
+** randdata() makes as 0.  The LCG can't seek; there this is a
+** no-op.
+*/
+void randseek(ulong index)
+{
+    randstate=randbase+(unsigned long long)index*SPLITMIX_GAMMA;
+}
+
+/****************************
+*      RandParallel()       *
+*****************************
+** Generate elements 0 to n-1 of the current data set with
+** fill(arg,first,last), which must randseek() to each element
+** (or block of elements) it generates.  With RANDGEN=SPLITMIX
+** and at least RANDPARMIN elements the range is split over up
+** to global_initthreads threads; otherwise fill() is called
+** once for all of it.  The data is the same either way.  On
+** Linux the helpers, and the caller while it fills its part,
+** are bound to the CPUs of the caller's NUMA node that it may
+** run on, so the pages they first touch are placed on the node
+** the benchmark thread runs on, even when nbench is not bound.
+*/
+void RandParallel(void (*fill)(void *arg, ulong first, ulong last),
+        void *arg, ulong n)
+{
+#if defined(LINUX) || defined(OSX)
+    RandPartStruct *parts;
+    pthread_t *threads;
+    pthread_attr_t *pattr;
+    ulong chunk;
+    int nthreads, i;
+#ifdef LINUX
+    pthread_attr_t attr;
+    cpu_set_t node, own;
+    int bound;
+#endif
+
+    nthreads=global_initthreads;
+    if(global_randgen!=RAND_SPLITMIX || nthreads<2 || n<RANDPARMIN)
+    {   fill(arg,0,n);
+        return;
+    }
+    if((ulong)nthreads>n/RANDPARCHUNK)
+        nthreads=(int)(n/RANDPARCHUNK);
+    parts=(RandPartStruct *)malloc(sizeof(RandPartStruct)*nthreads);
+    threads=(pthread_t *)malloc(sizeof(pthread_t)*nthreads);
+    if(parts==(RandPartStruct *)NULL || threads==(pthread_t *)NULL)
+    {   free(parts);
+        free(threads);
+        fill(arg,0,n);
+        return;
+    }
+
+    /*
+     ** Whole chunks to each thread, the rest to the last.
+     */
+    chunk=n/RANDPARCHUNK/(ulong)nthreads*RANDPARCHUNK;
+    for(i=0;i<nthreads;i++)
+    {   parts[i].fill=fill;
+        parts[i].arg=arg;
+        parts[i].first=(ulong)i*chunk;
+        parts[i].last=i==nthreads-1 ? n : (ulong)(i+1)*chunk;
+        parts[i].base=randbase;
+        parts[i].started=0;
+    }
+
+    /*
+     ** Keep the caller and the helpers on the caller's node.
+     */
+    pattr=(pthread_attr_t *)NULL;
+#ifdef LINUX
+    bound=0;
+    if(rand_nodecpus(&node)==0 &&
+      sched_getaffinity(0,sizeof(own),&own)==0)
+    {   if(pthread_attr_init(&attr)==0)
+        {   if(pthread_attr_setaffinity_np(&attr,sizeof(node),&node)==0)
+                pattr=&attr;
+            else
+                pthread_attr_destroy(&attr);
+        }
+        bound=sched_setaffinity(0,sizeof(node),&node)==0;
+    }
+#endif
+    for(i=1;i<nthreads;i++)
+        parts[i].started=pthread_create(&threads[i],pattr,rand_part,
+          &parts[i])==0;
+    for(i=0;i<nthreads;i++)
+        if(!parts[i].started)
+            fill(arg,parts[i].first,parts[i].last);
+    for(i=1;i<nthreads;i++)
+        if(parts[i].started)
+            pthread_join(threads[i],0);
+    if(pattr!=(pthread_attr_t *)NULL)
+        pthread_attr_destroy(pattr);
+#ifdef LINUX
+    if(bound)
+        sched_setaffinity(0,sizeof(own),&own);
+#endif
+    free(parts);
+    free(threads);
+#else
+    fill(arg,0,n);
+#endif
+}
+
+#if defined(LINUX) || defined(OSX)
+/***************
+** rand_part **
+****************
+** Body of a RandParallel() helper: adopt the caller's data set
+** and fill its part.
+*/
+static void *rand_part(void *data)
+{
+    RandPartStruct *part;
+
+    part=(RandPartStruct *)data;
+    randbase=part->base;
+    part->fill(part->arg,part->first,part->last);
+    return 0;
+}
+#endif
+
+#ifdef LINUX
+/*******************
+** rand_nodecpus **
+********************
+** The CPUs of the NUMA node the calling thread runs on that it
+** may run on.  Returns 0 if ok, -1 if the node is unknown.
+*/
+static int rand_nodecpus(cpu_set_t *set)
+{
+    char path[64];
+    char list[1024];
+    cpu_set_t allowed;
+    DIR *dir;
+    struct dirent *de;
+    FILE *fp;
+    char *cp, *ep;
+    long first, last;
+    int cpu, node;
+
+    cpu=sched_getcpu();
+    if(cpu<0) return(-1);
+
+    /*
+     ** The node shows as a nodeN link in the CPU's directory.
+     */
+    sprintf(path,"/sys/devices/system/cpu/cpu%d",cpu);
+    dir=opendir(path);
+    if(dir==(DIR *)NULL) return(-1);
+    node=-1;
+    while((de=readdir(dir))!=(struct dirent *)NULL)
+        if(strncmp(de->d_name,"node",4)==0 &&
+          de->d_name[4]>='0' && de->d_name[4]<='9')
+        {   node=atoi(de->d_name+4);
+            break;
+        }
+    closedir(dir);
+    if(node<0) return(-1);
+
+    sprintf(path,"/sys/devices/system/node/node%d/cpulist",node);
+    fp=fopen(path,"r");
+    if(fp==(FILE *)NULL) return(-1);
+    if(fgets(list,sizeof(list),fp)==(char *)NULL)
+    {   fclose(fp);
+        return(-1);
+    }
+    fclose(fp);
+
+    /*
+     ** A list such as "0-3,8-11".
+     */
+    CPU_ZERO(set);
+    cp=list;
+    for(;;)
+    {   first=strtol(cp,&ep,10);
+        if(ep==cp) break;
+        last=first;
+        if(*ep=='-')
+        {   cp=ep+1;
+            last=strtol(cp,&ep,10);
+        }
+        for(;first<=last && first<CPU_SETSIZE;first++)
+            CPU_SET((int)first,set);
+        cp=ep;
+        if(*cp!=',') break;
+        cp++;
+    }
+
+    if(sched_getaffinity(0,sizeof(allowed),&allowed)!=0)
+        return(-1);
+    CPU_AND(set,set,&allowed);
+    return(CPU_COUNT(set)>0 ? 0 : -1);
+}
+#endif
+
+static void *bench_thread(void *data);
+
 /*********************************
 *   run_bench_with_concurrency   *
 **********************************
@@ -145,7 +440,8 @@ void run_bench_with_concurrency(TestControlStruct *testctl, void *(*thread_func)
     for (i=1;i<global_concurrency;i++) {
         int systemerror;        /* For holding error codes */
         testdatas[i].control = testctl;
-        systemerror = pthread_create(&threads[i], 0, thread_func, &testdatas[i]);
+        testdatas[i].thread_func = thread_func;
+        systemerror = pthread_create(&threads[i], 0, bench_thread, &testdatas[i]);
         if(systemerror)
         {
             ReportError(testctl->errorcontext,systemerror);
@@ -157,7 +453,8 @@ void run_bench_with_concurrency(TestControlStruct *testctl, void *(*thread_func)
 #endif
 
     testdatas[0].control = testctl;
-    thread_func(&testdatas[0]);
+    testdatas[0].thread_func = thread_func;
+    bench_thread(&testdatas[0]);
     testctl->result = testdatas[0].result;
 
 #if defined(LINUX) || defined(OSX)
@@ -178,6 +475,37 @@ void run_bench_with_concurrency(TestControlStruct *testctl, void *(*thread_func)
 #endif
 }
 
+/*******************************
+*         bench_thread()       *
+********************************
+**  per-thread wrapper around a benchmark body
+**  sets up and collects the thread's hardware counters
+**  and profiler samples (and, in OPCOUNT builds, operation counts)
+*/
+static void *bench_thread(void *data)
+{
+    TestThreadData *testdata = (TestThreadData *)data;
+#ifdef OPCOUNT
+    int i;
+
+    for (i=0;i<NUMOPKINDS;i++)
+        opcount[i]=0;
+#endif
+
+    TraceThreadStart();
+    ProfThreadStart();
+    PerfThreadStart();
+    testdata->thread_func(data);
+    PerfThreadStop(testdata->result.perfcount);
+    ProfThreadStop();
+    TraceThreadStop();
+#ifdef OPCOUNT
+    for (i=0;i<NUMOPKINDS;i++)
+        testdata->result.opcount[i]=(double)opcount[i];
+#endif
+    return 0;
+}
+
 /*******************************
 *         merge_result()       *
 ********************************
@@ -185,7 +513,15 @@ void run_bench_with_concurrency(TestControlStruct *testctl, void *(*thread_func)
 */
 void merge_result(TestResultStruct *merged_result, TestResultStruct *single_result)
 {
+    int i;
+
     merged_result->iterations += single_result->iterations;
     merged_result->cpusecs += single_result->cpusecs;
     nbench_set_max(merged_result->realsecs, single_result->realsecs);
+    for (i=0;i<MAXPERFCOUNTERS;i++)
+        merged_result->perfcount[i] += single_result->perfcount[i];
+#ifdef OPCOUNT
+    for (i=0;i<NUMOPKINDS;i++)
+        merged_result->opcount[i] += single_result->opcount[i];
+#endif
 }
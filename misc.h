@@ -36,6 +36,27 @@ long randnum(long lngval);
 int32 randwc(int32 num);
 u32 abs_randwc(u32 num);
 int32 randnum(int32 lngval);
+void randdata(void);
+void randseek(ulong index);
+void RandParallel(void (*fill)(void *arg, ulong first, ulong last),
+        void *arg, ulong n);
+
+extern int global_freshdata;    /* New input data every iteration */
+extern int global_randgen;      /* Generator of input data (RAND_xxx) */
+extern int global_initthreads;  /* Threads RandParallel() may use */
+
+/*
+** Generators of input data (RANDGEN).
+*/
+#define RAND_LCG 0              /* BYTEmark's own, sequential */
+#define RAND_SPLITMIX 1         /* SplitMix64, counter-based */
+
+/*
+** RandParallel() splits only data sets of RANDPARMIN elements
+** or more, in multiples of RANDPARCHUNK.
+*/
+#define RANDPARMIN (1UL<<20)
+#define RANDPARCHUNK 4096UL
 
 #define nbench_set_max(max, x) max = x > max ? x : max
 
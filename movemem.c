@@ -0,0 +1,466 @@
+
+/*
+** movemem.c
+** MoveMemory() implementations and the memmove test.
+**
+** The string sort spends most of its time in MoveMemory():
+** every exchange of two strings shifts the tail of the string
+** array.  Which copy is fastest depends on the CPU, the size
+** and whether source and destination overlap, so MoveMemory()
+** calls through move_impl, which MEMMOVE selects: libc
+** memmove(), rep movsb, unrolled AVX2 or AVX-512 loops, or
+** non-temporal stores, which keep large moves from evicting
+** the caches.  MOVE_AUTO chooses per call.  The memmove test
+** times the selected implementation on a string-sort-like
+** shift; its report sweeps every implementation over sizes,
+** overlap and alignment.
+*/
+
+/*
+** INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "sysspec.h"
+#include "misc.h"
+#include "hardware.h"
+#include "movemem.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MOVE_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+/*
+** Global parameters.
+*/
+int global_movemem;             /* Implementation asked for (MOVE_xxx) */
+
+char *movenames[MOVEKINDS] = {
+        "libc", "movsb", "avx2", "avx512", "nt", "auto" };
+
+#define MOVE_NTMIN (4UL<<20)    /* Smallest MOVE_AUTO non-temporal move */
+#define MOVE_LOOPBYTES (16UL<<20) /* Bytes moved per timed region */
+
+static unsigned long move_ntbytes=MOVE_NTMIN; /* MOVE_AUTO goes non-temporal */
+static int move_erms;           /* Fast rep movsb */
+
+/*
+** PROTOTYPES
+*/
+static void move_libc(void *destination, const void *source,
+        unsigned long nbytes);
+#ifdef MOVE_X86
+static void move_movsb(void *destination, const void *source,
+        unsigned long nbytes);
+static void move_avx2(void *destination, const void *source,
+        unsigned long nbytes);
+static void move_avx512(void *destination, const void *source,
+        unsigned long nbytes);
+static void move_nt(void *destination, const void *source,
+        unsigned long nbytes);
+#endif
+static void move_auto(void *destination, const void *source,
+        unsigned long nbytes);
+static void *MemMoveFunc(void *data);
+
+MoveFunc move_impl=move_libc;
+
+/***************
+** move_libc **
+****************
+** The C library's memmove().
+*/
+static void move_libc(void *destination, const void *source,
+        unsigned long nbytes)
+{
+    memmove(destination,source,(size_t)nbytes);
+}
+
+#ifdef MOVE_X86
+
+/*
+** Overlap test: a forward copy is safe unless the destination
+** starts inside the source.
+*/
+#define FORWARD_SAFE(d,s,n) ((d)<=(s) || (d)>=(s)+(n))
+
+/****************
+** move_movsb **
+*****************
+** rep movsb; backwards, with the direction flag set, when
+** the destination starts inside the source.
+*/
+static void move_movsb(void *destination, const void *source,
+        unsigned long nbytes)
+{
+    unsigned char *d=(unsigned char *)destination;
+    const unsigned char *s=(const unsigned char *)source;
+
+    if(FORWARD_SAFE(d,s,nbytes))
+        __asm__ __volatile__("rep movsb"
+                : "+D"(d), "+S"(s), "+c"(nbytes) : : "memory");
+    else
+    {   d+=nbytes-1;
+        s+=nbytes-1;
+        __asm__ __volatile__("std\n\trep movsb\n\tcld"
+                : "+D"(d), "+S"(s), "+c"(nbytes) : : "memory");
+    }
+}
+
+/***************
+** move_avx2 **
+****************
+** Four 32-byte loads, then four stores, per trip; every trip
+** reads its source before writing, so overlap is safe in the
+** direction chosen.
+*/
+__attribute__((target("avx2")))
+static void move_avx2(void *destination, const void *source,
+        unsigned long nbytes)
+{
+    unsigned char *d=(unsigned char *)destination;
+    const unsigned char *s=(const unsigned char *)source;
+    __m256i v0, v1, v2, v3;
+
+    if(FORWARD_SAFE(d,s,nbytes))
+    {   for(;nbytes>=128;nbytes-=128,d+=128,s+=128)
+        {   v0=_mm256_loadu_si256((const __m256i *)s);
+            v1=_mm256_loadu_si256((const __m256i *)(s+32));
+            v2=_mm256_loadu_si256((const __m256i *)(s+64));
+            v3=_mm256_loadu_si256((const __m256i *)(s+96));
+            _mm256_storeu_si256((__m256i *)d,v0);
+            _mm256_storeu_si256((__m256i *)(d+32),v1);
+            _mm256_storeu_si256((__m256i *)(d+64),v2);
+            _mm256_storeu_si256((__m256i *)(d+96),v3);
+        }
+        for(;nbytes>=32;nbytes-=32,d+=32,s+=32)
+        {   v0=_mm256_loadu_si256((const __m256i *)s);
+            _mm256_storeu_si256((__m256i *)d,v0);
+        }
+        while(nbytes--) *d++=*s++;
+    }
+    else
+    {   d+=nbytes;
+        s+=nbytes;
+        for(;nbytes>=128;nbytes-=128)
+        {   d-=128;
+            s-=128;
+            v0=_mm256_loadu_si256((const __m256i *)s);
+            v1=_mm256_loadu_si256((const __m256i *)(s+32));
+            v2=_mm256_loadu_si256((const __m256i *)(s+64));
+            v3=_mm256_loadu_si256((const __m256i *)(s+96));
+            _mm256_storeu_si256((__m256i *)d,v0);
+            _mm256_storeu_si256((__m256i *)(d+32),v1);
+            _mm256_storeu_si256((__m256i *)(d+64),v2);
+            _mm256_storeu_si256((__m256i *)(d+96),v3);
+        }
+        for(;nbytes>=32;nbytes-=32)
+        {   d-=32;
+            s-=32;
+            v0=_mm256_loadu_si256((const __m256i *)s);
+            _mm256_storeu_si256((__m256i *)d,v0);
+        }
+        while(nbytes--) *--d=*--s;
+    }
+    _mm256_zeroupper();
+}
+
+/*****************
+** move_avx512 **
+******************
+** As move_avx2(), with 64-byte vectors.
+*/
+__attribute__((target("avx512f")))
+static void move_avx512(void *destination, const void *source,
+        unsigned long nbytes)
+{
+    unsigned char *d=(unsigned char *)destination;
+    const unsigned char *s=(const unsigned char *)source;
+    __m512i v0, v1, v2, v3;
+
+    if(FORWARD_SAFE(d,s,nbytes))
+    {   for(;nbytes>=256;nbytes-=256,d+=256,s+=256)
+        {   v0=_mm512_loadu_si512((const void *)s);
+            v1=_mm512_loadu_si512((const void *)(s+64));
+            v2=_mm512_loadu_si512((const void *)(s+128));
+            v3=_mm512_loadu_si512((const void *)(s+192));
+            _mm512_storeu_si512((void *)d,v0);
+            _mm512_storeu_si512((void *)(d+64),v1);
+            _mm512_storeu_si512((void *)(d+128),v2);
+            _mm512_storeu_si512((void *)(d+192),v3);
+        }
+        for(;nbytes>=64;nbytes-=64,d+=64,s+=64)
+        {   v0=_mm512_loadu_si512((const void *)s);
+            _mm512_storeu_si512((void *)d,v0);
+        }
+        while(nbytes--) *d++=*s++;
+    }
+    else
+    {   d+=nbytes;
+        s+=nbytes;
+        for(;nbytes>=256;nbytes-=256)
+        {   d-=256;
+            s-=256;
+            v0=_mm512_loadu_si512((const void *)s);
+            v1=_mm512_loadu_si512((const void *)(s+64));
+            v2=_mm512_loadu_si512((const void *)(s+128));
+            v3=_mm512_loadu_si512((const void *)(s+192));
+            _mm512_storeu_si512((void *)d,v0);
+            _mm512_storeu_si512((void *)(d+64),v1);
+            _mm512_storeu_si512((void *)(d+128),v2);
+            _mm512_storeu_si512((void *)(d+192),v3);
+        }
+        for(;nbytes>=64;nbytes-=64)
+        {   d-=64;
+            s-=64;
+            v0=_mm512_loadu_si512((const void *)s);
+            _mm512_storeu_si512((void *)d,v0);
+        }
+        while(nbytes--) *--d=*--s;
+    }
+}
+
+/*************
+** move_nt **
+**************
+** Non-temporal 16-byte stores from an aligned destination,
+** fenced at the end.  Only for moves that do not overlap;
+** the others go to memmove().
+*/
+__attribute__((target("sse2")))
+static void move_nt(void *destination, const void *source,
+        unsigned long nbytes)
+{
+    unsigned char *d=(unsigned char *)destination;
+    const unsigned char *s=(const unsigned char *)source;
+    __m128i v0, v1, v2, v3;
+
+    if(d<s+nbytes && s<d+nbytes)
+    {   memmove(destination,source,(size_t)nbytes);
+        return;
+    }
+    while(nbytes && ((unsigned long)d&15UL))
+    {   *d++=*s++;
+        nbytes--;
+    }
+    for(;nbytes>=64;nbytes-=64,d+=64,s+=64)
+    {   v0=_mm_loadu_si128((const __m128i *)s);
+        v1=_mm_loadu_si128((const __m128i *)(s+16));
+        v2=_mm_loadu_si128((const __m128i *)(s+32));
+        v3=_mm_loadu_si128((const __m128i *)(s+48));
+        _mm_stream_si128((__m128i *)d,v0);
+        _mm_stream_si128((__m128i *)(d+16),v1);
+        _mm_stream_si128((__m128i *)(d+32),v2);
+        _mm_stream_si128((__m128i *)(d+48),v3);
+    }
+    _mm_sfence();
+    while(nbytes--) *d++=*s++;
+}
+
+#endif
+
+/***************
+** move_auto **
+****************
+** Small moves go to libc, large moves that do not overlap
+** to non-temporal stores, the rest forward to rep movsb where
+** it is fast, else to the widest vector loop.
+*/
+static void move_auto(void *destination, const void *source,
+        unsigned long nbytes)
+{
+#ifdef MOVE_X86
+    unsigned char *d=(unsigned char *)destination;
+    const unsigned char *s=(const unsigned char *)source;
+
+    if(nbytes>=MOVE_SMALL)
+    {   if(nbytes>=move_ntbytes && (d>=s+nbytes || s>=d+nbytes))
+        {   move_nt(destination,source,nbytes);
+            return;
+        }
+        if(move_erms && FORWARD_SAFE(d,s,nbytes))
+        {   move_movsb(destination,source,nbytes);
+            return;
+        }
+        if(MoveAvailable(MOVE_AVX512))
+        {   move_avx512(destination,source,nbytes);
+            return;
+        }
+        if(MoveAvailable(MOVE_AVX2))
+        {   move_avx2(destination,source,nbytes);
+            return;
+        }
+    }
+#endif
+    memmove(destination,source,(size_t)nbytes);
+}
+
+/******************
+** MoveAvailable **
+*******************
+** Whether implementation kind runs on this CPU.
+*/
+int MoveAvailable(int kind)
+{
+    switch(kind)
+    {
+        case MOVE_LIBC:
+        case MOVE_AUTO:
+            return(1);
+#ifdef MOVE_X86
+        case MOVE_MOVSB:
+        case MOVE_NT:
+            return(1);
+        case MOVE_AVX2:
+            return(__builtin_cpu_supports("avx2"));
+        case MOVE_AVX512:
+            return(__builtin_cpu_supports("avx512f"));
+#endif
+    }
+    return(0);
+}
+
+/*****************
+** MoveFunction **
+******************
+** The function implementing kind.
+*/
+MoveFunc MoveFunction(int kind)
+{
+    switch(kind)
+    {
+#ifdef MOVE_X86
+        case MOVE_MOVSB: return(move_movsb);
+        case MOVE_AVX2: return(move_avx2);
+        case MOVE_AVX512: return(move_avx512);
+        case MOVE_NT: return(move_nt);
+#endif
+        case MOVE_AUTO: return(move_auto);
+    }
+    return(move_libc);
+}
+
+/***************
+** MoveSelect **
+****************
+** Make MoveMemory() use implementation kind.  MOVE_AUTO goes
+** non-temporal from half the last level cache up.  Returns 0
+** if ok, -1 if kind does not run here; then MoveMemory() keeps
+** using libc and reason holds a short explanation.
+*/
+int MoveSelect(int kind, char *reason)
+{
+#ifdef MOVE_X86
+    unsigned int eax, ebx, ecx, edx;
+
+    if(__get_cpuid_count(7,0,&eax,&ebx,&ecx,&edx))
+        move_erms=(ebx>>9)&1;
+#endif
+    move_ntbytes=LLCSize()/2;
+    if(move_ntbytes<MOVE_NTMIN) move_ntbytes=MOVE_NTMIN;
+
+    if(!MoveAvailable(kind))
+    {   sprintf(reason,"%s is not supported on this CPU",movenames[kind]);
+        move_impl=move_libc;
+        return(-1);
+    }
+    move_impl=MoveFunction(kind);
+    return(0);
+}
+
+/************
+** MoveGBs **
+*************
+** Time implementation kind moving nbytes from src to dst for
+** at least secs seconds and return GB/s.
+*/
+double MoveGBs(int kind, char *dst, char *src, unsigned long nbytes,
+        double secs)
+{
+    StopWatchStruct stopwatch;
+    MoveFunc func;
+    unsigned long loops, i;
+    double moved;
+
+    func=MoveFunction(kind);
+    loops=MOVE_LOOPBYTES/(nbytes*16UL)+1;
+    moved=(double)0.0;
+    ResetStopWatch(&stopwatch);
+    do {
+        StartStopWatch(&stopwatch);
+        for(i=0;i<loops;i++)
+            (*func)(dst,src,nbytes);
+        StopStopWatch(&stopwatch);
+        moved+=(double)loops*(double)nbytes;
+    } while(stopwatch.realsecs<secs);
+    return(moved/stopwatch.realsecs*1e-9);
+}
+
+/**************
+** DoMemMove **
+***************
+** Perform the memmove test: MoveMemory() shifting a block of
+** the test's array size back and forth by a few bytes, as the
+** string sort shifts the tail of its string array.
+*/
+void DoMemMove(void)
+{
+    TestControlStruct *locmovestruct;     /* Local memmove structure */
+
+    locmovestruct=&global_memmovestruct;
+    locmovestruct->loops=MOVE_LOOPBYTES/(locmovestruct->arraysize*16UL)+1;
+    locmovestruct->adjust=1;
+
+    run_bench_with_concurrency(locmovestruct, MemMoveFunc);
+}
+
+/****************
+** MemMoveFunc **
+*****************
+** Body of one memmove thread.  An iteration is one move.
+*/
+static void *MemMoveFunc(void *data)
+{
+    TestThreadData *testdata;       /* test data passed from thread func */
+    TestControlStruct *locmovestruct;       /* Local pointer to global struct */
+    StopWatchStruct stopwatch;      /* Stop watch to time the test */
+    char *buf;
+    int systemerror;                /* For holding error code */
+    ulong n, i;
+
+    testdata=(TestThreadData *)data;
+    locmovestruct=testdata->control;
+    n=locmovestruct->arraysize;
+
+    buf=(char *)AllocateMemory(n+MEMMOVESHIFT,&systemerror);
+    if(systemerror)
+    {
+        ReportError(locmovestruct->errorcontext,systemerror);
+        ErrorExit();
+    }
+    for(i=0;i<n+MEMMOVESHIFT;i++)
+        buf[i]=(char)i;
+
+    testdata->result.iterations=0.0;
+    ResetStopWatch(&stopwatch);
+    do {
+        StartStopWatch(&stopwatch);
+        for(i=0;i<locmovestruct->loops;i++)
+        {   MoveMemory((farvoid *)(buf+MEMMOVESHIFT),(farvoid *)buf,n);
+            MoveMemory((farvoid *)buf,(farvoid *)(buf+MEMMOVESHIFT),n);
+        }
+        StopStopWatch(&stopwatch);
+        testdata->result.iterations+=(double)(2*locmovestruct->loops);
+    } while(stopwatch.realsecs<locmovestruct->request_secs);
+
+    FreeMemory((farvoid *)buf,&systemerror);
+
+    testdata->result.cpusecs=stopwatch.cpusecs;
+    testdata->result.realsecs=stopwatch.realsecs;
+
+    return 0;
+}
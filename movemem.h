@@ -0,0 +1,44 @@
+/*
+** movemem.h
+** Header for movemem.c
+** MoveMemory() implementations and the memmove test.
+*/
+
+/*
+** Implementations.  MOVE_AUTO picks one per call by size,
+** overlap and the features of the CPU.
+*/
+#define MOVE_LIBC 0             /* libc memmove() */
+#define MOVE_MOVSB 1            /* rep movsb */
+#define MOVE_AVX2 2             /* 32-byte vector loop */
+#define MOVE_AVX512 3           /* 64-byte vector loop */
+#define MOVE_NT 4               /* Non-temporal stores, large moves */
+#define MOVE_AUTO 5             /* Chosen per call */
+#define MOVEKINDS 6
+
+/*
+** MOVE_AUTO leaves moves below MOVE_SMALL to libc.
+*/
+#define MOVE_SMALL 2048UL
+
+/*
+** TYPEDEFS
+*/
+typedef void (*MoveFunc)(void *destination, const void *source,
+        unsigned long nbytes);
+
+/*
+** EXTERNALS
+*/
+extern int global_movemem;      /* Implementation asked for (MOVE_xxx) */
+extern MoveFunc move_impl;      /* The one MoveMemory() calls */
+extern char *movenames[MOVEKINDS];
+
+/*
+** PROTOTYPES
+*/
+int MoveAvailable(int kind);
+int MoveSelect(int kind, char *reason);
+MoveFunc MoveFunction(int kind);
+double MoveGBs(int kind, char *dst, char *src, unsigned long nbytes,
+        double secs);
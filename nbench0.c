@@ -51,10 +51,27 @@
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#ifdef LINUX
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 #include "nmglobal.h"
+#include "misc.h"
 #include "sysspec.h"
+#include "noisemon.h"
+#include "energy.h"
+#include "cold.h"
+#include "footprint.h"
 #include "nbench0.h"
 #include "hardware.h"
+#include "perfmon.h"
+#include "freqmon.h"
+#include "profile.h"
+#include "roofline.h"
+#include "prefetch.h"
+#include "movemem.h"
+#include "trace.h"
 
 /*
 ** Following array is a collection of flags indicating which
@@ -62,6 +79,22 @@
 */
 int tests_to_do[NUMTESTS];
 
+/*
+** Scored runs of the test currently being benchmarked.
+*/
+SampleStruct samples[30];
+int rejected_samples;           /* Disturbed runs thrown away */
+
+/*
+** Compute and bandwidth roofs of this host.
+*/
+RoofStruct roof;
+
+/*
+** Warmup runs of the test currently being benchmarked.
+*/
+WarmupStruct warmup;
+
 /*
 ** Global parameters.
 */
@@ -73,6 +106,11 @@ char global_ofile_name[BUF_SIZ];/* Output file name */
 FILE *global_ofile;             /* Output file */
 int global_custrun;             /* Custom run flag */
 int write_to_file;              /* Write output to file */
+int global_freshcheck;          /* Compare with fresh input data */
+ulong global_warmup_secs;       /* Minimum seconds of warmup per test */
+ulong global_warmup_runs;       /* Minimum warmup passes per test */
+int global_isolate;             /* Run every test in its own process */
+int global_alignsweep;          /* Rerun tests at every block offset */
 
 /*
 ** Following are global structures, one built for
@@ -88,6 +126,11 @@ TestControlStruct global_ideastruct;          /* For IDEA encryption */
 TestControlStruct global_huffstruct;          /* For Huffman compression */
 TestControlStruct global_nnetstruct;          /* For Neural Net */
 TestControlStruct global_lustruct;            /* For LU decomposition */
+TestControlStruct global_streamstruct;        /* For STREAM bandwidth */
+TestControlStruct global_latencystruct;       /* For memory latency */
+TestControlStruct global_memmovestruct;       /* For memmove */
+TestControlStruct global_churnstruct;         /* For allocator churn */
+TestControlStruct global_faultstruct;         /* For page faults */
 
 
 /*
@@ -106,7 +149,12 @@ void *global_fstruct[] =
         (void *)&global_ideastruct,
         (void *)&global_huffstruct,
         (void *)&global_nnetstruct,
-        (void *)&global_lustruct };
+        (void *)&global_lustruct,
+        (void *)&global_streamstruct,
+        (void *)&global_latencystruct,
+        (void *)&global_memmovestruct,
+        (void *)&global_churnstruct,
+        (void *)&global_faultstruct };
 
 /*
 ** Array of pointers to the benchmark functions.
@@ -121,7 +169,12 @@ void (*funcpointer[])(void) =
         DoIDEA,
         DoHuffman,
         DoNNET,
-        DoLU };
+        DoLU,
+        DoStream,
+        DoLatency,
+        DoMemMove,
+        DoChurn,
+        DoFault };
 
 /*************
 **** main ****
@@ -136,14 +189,16 @@ int main(int argc, char *argv[])
     time_t time_and_date;   /* Self-explanatory */
     struct tm *loctime;
     double bmean;           /* Benchmark mean */
-    double bstdev;          /* Benchmark stdev */
     double lx_memindex;     /* Linux memory index (mainly integer operations)*/
     double lx_intindex;     /* Linux integer index */
     double lx_fpindex;      /* Linux floating-point index */
     double intindex;        /* Integer index */
     double fpindex;         /* Floating-point index */
-    ulong bnumrun;          /* # of runs */
+    double streamgbs;       /* STREAM bandwidth, GB/s */
+    double latencyns;       /* Memory latency, ns per load */
     char buffer[BUF_SIZ];   /* Buffer for holding output text. */
+    char reason[80];        /* Why an optional analysis is unavailable */
+    char timer[80];         /* Stopwatch description */
 
 #ifdef MAC
     MaxApplZone();
@@ -185,8 +240,31 @@ int main(int argc, char *argv[])
     global_allstats=0;
     global_custrun=0;
     global_align=8;
+    global_topdown=0;
+    global_freqmon=0;
+    global_noisemon=0;
+    global_noisereject=0;
+    global_profile=0;
+    global_roofline=0;
+    global_prefetch=0;
+    global_prefetchsize=0;          /* Sized from the caches */
+    global_prefetchstride=PREFETCHMAXSTRIDE;
+    global_trace=0;
+    global_energy=0;
+    global_cold=0;
+    global_freshcheck=0;
+    global_warmup_secs=0;
+    global_warmup_runs=0;
+    global_footprint=0;
+    global_isolate=0;
+    global_hugepages=HUGE_OFF;
+    global_alignsweep=0;
+    global_randgen=RAND_LCG;
+    global_initthreads=0;           /* One per CPU left over */
     write_to_file=0;
     lx_memindex=(double)1.0;        /* set for geometric mean computations */
+    streamgbs=(double)0.0;
+    latencyns=(double)0.0;
     lx_intindex=(double)1.0;
     lx_fpindex=(double)1.0;
     intindex=(double)1.0;
@@ -200,7 +278,7 @@ int main(int argc, char *argv[])
      ** otherwise
      */
     for(i=0;i<NUMTESTS;i++)
-        tests_to_do[i]=1;
+        tests_to_do[i]=(i<NUMINDEXTESTS);
 
     /*
      ** Initialize test data structures to default
@@ -243,6 +321,28 @@ int main(int argc, char *argv[])
     global_lustruct.adjust=0;
     global_lustruct.errorcontext="FPU:LU";
 
+    global_streamstruct.adjust=0;
+    global_streamstruct.arraysize=0;        /* Sized from the caches */
+    global_streamstruct.errorcontext="MEM:STREAM";
+
+    global_latencystruct.adjust=0;
+    global_latencystruct.arraysize=0;       /* Sized from the caches */
+    global_latencystruct.errorcontext="MEM:Latency";
+    global_latencymax=0;
+
+    global_memmovestruct.adjust=0;
+    global_memmovestruct.arraysize=MEMMOVESIZE;
+    global_memmovestruct.errorcontext="MEM:memmove";
+    global_movemem=MOVE_LIBC;
+
+    global_churnstruct.adjust=0;
+    global_churnstruct.arraysize=CHURNLIVE;
+    global_churnstruct.errorcontext="MEM:churn";
+
+    global_faultstruct.adjust=0;
+    global_faultstruct.arraysize=FAULTSIZE;
+    global_faultstruct.errorcontext="MEM:fault";
+
     /*
      ** For Macintosh -- read the command line.
      */
@@ -260,6 +360,21 @@ int main(int argc, char *argv[])
                 display_help(argv[0]);
                 exit(0);
             }
+    size_from_caches();
+
+    /*
+     ** By default, data is built on the CPUs the benchmark
+     ** threads leave over.
+     */
+    if(global_initthreads<=0)
+    {   global_initthreads=1;
+#ifdef LINUX
+        if(sysconf(_SC_NPROCESSORS_ONLN)>(long)global_concurrency)
+            global_initthreads=(int)(sysconf(_SC_NPROCESSORS_ONLN)/
+                (long)global_concurrency);
+#endif
+    }
+
     /*
      ** Output header
      */
@@ -299,6 +414,14 @@ int main(int argc, char *argv[])
                 (unsigned int)sizeof(u32),
                 (unsigned int)sizeof(int32));
         output_string(buffer);
+        DescribeStopWatch(timer);
+        sprintf(buffer,"**Stopwatch: %s\n",timer);
+        output_string(buffer);
+        sprintf(buffer,"**Stopwatch overhead: %.0f ns per Start/Stop pair, %.0f ns real / %.0f ns CPU subtracted per region\n",
+                global_sw_pair_cost*1e9,global_sw_overhead_real*1e9,global_sw_overhead_cpu*1e9);
+        output_string(buffer);
+        sprintf(buffer,"**Minimum iteration time: %g s\n",(double)global_min_itersec);
+        output_string(buffer);
 #ifdef LINUX
 #include "sysinfo.c"
 #else
@@ -312,6 +435,99 @@ int main(int argc, char *argv[])
         output_string("=============================================================================\n");
     }
 
+    /*
+     ** Set up the hardware counters needed by the optional
+     ** analyses.  Missing counters never stop the run.
+     */
+    if(global_topdown && PerfAddTopdown(reason)!=0)
+    {
+        sprintf(buffer,"** Top-down analysis unavailable: %s\n",reason);
+        output_string(buffer);
+    }
+    if(global_hugepages!=HUGE_OFF && PerfAddTlb(reason)!=0)
+    {
+        sprintf(buffer,"** Data TLB counters unavailable: %s\n",reason);
+        output_string(buffer);
+    }
+    if(global_freqmon && PerfAddFrequency(reason)!=0)
+    {
+        sprintf(buffer,"** APERF/MPERF unavailable: %s\n",reason);
+        output_string(buffer);
+        if(FreqInit(reason)!=0)
+        {
+            sprintf(buffer,"** Clock monitor unavailable: %s\n",reason);
+            output_string(buffer);
+        }
+    }
+    else if(global_freqmon)
+        FreqInit(reason);
+#ifdef OPCOUNT
+    /*
+     ** show_opcount() turns ns/op into core cycles with APERF
+     ** where it can; without it, it falls back to TSC cycles.
+     */
+    else
+        PerfAddFrequency(reason);
+#endif
+    if(global_noisereject)
+        global_noisemon=1;
+    if(global_noisemon && NoiseInit(reason)!=0)
+    {
+        sprintf(buffer,"** Noise attribution unavailable: %s\n",reason);
+        output_string(buffer);
+        global_noisemon=global_noisereject=0;
+    }
+    if(global_profile && ProfInit(reason)!=0)
+    {
+        sprintf(buffer,"** Profiler unavailable: %s\n",reason);
+        output_string(buffer);
+        global_profile=0;
+    }
+    if(global_energy && EnergyInit(reason)!=0)
+    {
+        sprintf(buffer,"** Energy unavailable: %s\n",reason);
+        output_string(buffer);
+    }
+    if(MoveSelect(global_movemem,reason)!=0)
+    {
+        sprintf(buffer,"** MoveMemory: %s; using libc\n",reason);
+        output_string(buffer);
+        global_movemem=MOVE_LIBC;
+    }
+    if(global_cold && ColdInit(reason)!=0)
+    {
+        sprintf(buffer,"** Cold-cache mode unavailable: %s\n",reason);
+        output_string(buffer);
+        global_cold=0;
+    }
+    if(global_trace && TraceOpen(reason)!=0)
+    {
+        sprintf(buffer,"** Trace unavailable: %s: %s\n",reason,global_tracefile);
+        output_string(buffer);
+    }
+    if(global_roofline)
+    {
+        if(RoofProbe(&roof,reason)!=0)
+        {   sprintf(buffer,"** Bandwidth roof unavailable: %s\n",reason);
+            output_string(buffer);
+        }
+        sprintf(buffer,"** Roofs (one thread): %.3g GFLOP/s, %.3g Gop/s integer; STREAM triad (%d thread%s): %.3g GB/s\n",
+                roof.gflops,roof.giops,global_concurrency,
+                global_concurrency>1 ? "s" : "",roof.gbs);
+        output_string(buffer);
+    }
+    if(global_prefetch)
+    {
+        if(PrefetchOpen(reason)!=0)
+        {   sprintf(buffer,"** Prefetch sweep unavailable: %s\n",reason);
+            output_string(buffer);
+        }
+        else
+        {   show_prefetch();
+            PrefetchClose();
+        }
+    }
+
     /*
      ** Execute the tests.
      */
@@ -327,26 +543,25 @@ int main(int argc, char *argv[])
         {
             sprintf(buffer,"%s    :",ftestnames[i]);
             output_string(buffer);
-            if (0!=bench_with_confidence(i,
-                        &bmean,
-                        &bstdev,
-                        &bnumrun)){
-                output_string("\n** WARNING: The current test result is NOT 95 % statistically certain.\n");
-                output_string("** WARNING: The variation among the individual results is too large.\n");
-                output_string("                    :");
-            }
-#ifdef LINUX
-            sprintf(buffer," %15.5g  :  %9.2f  :  %9.2f\n",
-                    bmean,bmean/bindex[i],bmean/lx_bindex[i]);
-#else
-            sprintf(buffer,"  Iterations/sec.: %13.2f  Index: %6.2f\n",
-                    bmean,bmean/bindex[i]);
-#endif
-            output_string(buffer);
+            if(global_isolate)
+                bmean=isolated_test(i);
+            else
+                bmean=run_test(i);
             /*
              ** Gather integer or FP indexes
              */
-            if((i==4)||(i==8)||(i==9)){
+            if(i>=NUMINDEXTESTS)
+            {
+                /*
+                 ** No baseline; only some give a summary figure
+                 */
+                if(i==TF_STREAM)
+                    streamgbs=bmean*(double)80.0*
+                        (double)global_streamstruct.arraysize*1e-9;
+                else if(i==TF_LATENCY)
+                    latencyns=(double)global_concurrency*1e9/bmean;
+            }
+            else if((i==4)||(i==8)||(i==9)){
                 /* FP index */
                 fpindex=fpindex*(bmean/bindex[i]);
                 /* Linux FP index */
@@ -362,23 +577,6 @@ int main(int argc, char *argv[])
                     /* Linux memory index */
                     lx_memindex=lx_memindex*(bmean/lx_bindex[i]);
             }
-
-            if(global_allstats)
-            {
-                sprintf(buffer,"  Absolute standard deviation: %g\n",bstdev);
-                output_string(buffer);
-                if (bmean>(double)1e-100){
-                    /* avoid division by zero */
-                    sprintf(buffer,"  Relative standard deviation: %g %%\n",
-                            (double)100*bstdev/bmean);
-                    output_string(buffer);
-                }
-                sprintf(buffer,"  Number of runs: %lu\n",bnumrun);
-                output_string(buffer);
-                show_stats(i);
-                sprintf(buffer,"Done with %s\n\n",ftestnames[i]);
-                output_string(buffer);
-            }
         }
     }
     /* printf("...done...\n"); */
@@ -403,6 +601,15 @@ int main(int argc, char *argv[])
         sprintf(buffer,"MEMORY INDEX        : %.3f\n",
                 pow(lx_memindex,(double).3333333333));
         output_string(buffer);
+        if(tests_to_do[TF_STREAM])
+        {   sprintf(buffer,"MEMORY BANDWIDTH    : %.3f GB/s (STREAM, %d thread%s)\n",
+                    streamgbs,global_concurrency,global_concurrency>1 ? "s" : "");
+            output_string(buffer);
+        }
+        if(tests_to_do[TF_LATENCY])
+        {   sprintf(buffer,"MEMORY LATENCY      : %.3f ns per load\n",latencyns);
+            output_string(buffer);
+        }
         sprintf(buffer,"INTEGER INDEX       : %.3f\n",
                 pow(lx_intindex,(double).25));
         output_string(buffer);
@@ -414,6 +621,7 @@ int main(int argc, char *argv[])
         output_string("* Trademarks are property of their respective holder.\n");
     }
 
+    TraceClose();
     exit(0);
 }
 
@@ -434,6 +642,11 @@ static int parse_arg(char *argptr)
      */
     if(*argptr++!='-') return(-1);
 
+    /*
+     ** A second hyphen introduces a long option.
+     */
+    if(*argptr=='-') return(parse_long_arg(argptr+1));
+
     /*
      ** Convert the rest of the argument to upper case
      ** so there's little chance of confusion.
@@ -472,6 +685,99 @@ static int parse_arg(char *argptr)
     return(0);
 }
 
+/*******************
+** parse_long_arg **
+********************
+** Handle a "--name" style argument (name passed without
+** the hyphens).  Long options are case sensitive.
+** Return 0 if ok, else return -1.
+*/
+static int parse_long_arg(char *argptr)
+{
+    if(strcmp(argptr,"topdown")==0)
+    {   global_topdown=1;
+        return(0);
+    }
+    if(strcmp(argptr,"freqmon")==0)
+    {   global_freqmon=1;
+        return(0);
+    }
+    if(strcmp(argptr,"noise")==0)
+    {   global_noisemon=1;
+        return(0);
+    }
+    if(strcmp(argptr,"reject-noisy")==0)
+    {   global_noisereject=1;
+        return(0);
+    }
+    if(strcmp(argptr,"profile")==0)
+    {   global_profile=1;
+        return(0);
+    }
+    if(strcmp(argptr,"roofline")==0)
+    {   global_roofline=1;
+        return(0);
+    }
+    if(strcmp(argptr,"energy")==0)
+    {   global_energy=1;
+        return(0);
+    }
+    if(strcmp(argptr,"cold")==0)
+    {   global_cold=1;
+        return(0);
+    }
+    if(strcmp(argptr,"fresh-data")==0)
+    {   global_freshcheck=1;
+        return(0);
+    }
+    if(strcmp(argptr,"footprint")==0)
+    {   global_footprint=1;
+        return(0);
+    }
+    if(strcmp(argptr,"isolate")==0)
+    {   global_isolate=1;
+        return(0);
+    }
+    if(strcmp(argptr,"align-sweep")==0)
+    {   global_alignsweep=1;
+        return(0);
+    }
+    if(strcmp(argptr,"prefetch-sweep")==0)
+    {   global_prefetch=1;
+        return(0);
+    }
+    if(strncmp(argptr,"memmove=",8)==0)
+    {   global_movemem=getmove(argptr+8);
+        return(0);
+    }
+    if(strncmp(argptr,"hugepages=",10)==0)
+    {   global_hugepages=gethuge(argptr+10);
+        return(0);
+    }
+    if(strncmp(argptr,"randgen=",8)==0)
+    {   global_randgen=getrandgen(argptr+8);
+        return(0);
+    }
+    if(strncmp(argptr,"init-threads=",13)==0)
+    {   global_initthreads=atoi(argptr+13);
+        return(0);
+    }
+    if(strncmp(argptr,"warmup=",7)==0)
+    {   global_warmup_secs=(ulong)atol(argptr+7);
+        return(0);
+    }
+    if(strncmp(argptr,"warmup-runs=",12)==0)
+    {   global_warmup_runs=(ulong)atol(argptr+12);
+        return(0);
+    }
+    if(strncmp(argptr,"trace=",6)==0 && strlen(argptr+6)<TRACEFILELEN)
+    {   strcpy(global_tracefile,argptr+6);
+        global_trace=1;
+        return(0);
+    }
+    return(-1);
+}
+
 /*******************
 ** display_help() **
 ********************
@@ -480,9 +786,29 @@ static int parse_arg(char *argptr)
 */
 void display_help(char *progname)
 {
-    printf("Usage: %s [-v] [-c<FILE>]\n",progname);
+    printf("Usage: %s [-v] [-c<FILE>] [--topdown] [--freqmon] [--noise] [--reject-noisy]\n       [--profile] [--roofline] [--trace=<FILE>]\n       [--energy] [--cold] [--fresh-data]\n       [--warmup=<SECS>] [--warmup-runs=<N>] [--footprint] [--isolate]\n       [--hugepages=<THP|2M|1G|OFF>] [--align-sweep]\n       [--prefetch-sweep] [--memmove=<LIBC|MOVSB|AVX2|AVX512|NT|AUTO>]\n       [--randgen=<LCG|SPLITMIX>] [--init-threads=<N>]\n",progname);
     printf(" -v = verbose\n");
     printf(" -c = input parameters thru command file <FILE>\n");
+    printf(" --topdown = top-down CPU breakdown per test (needs perf events)\n");
+    printf(" --freqmon = report CPU clock and throttling for every sample\n");
+    printf(" --noise   = report preemption, migrations, faults and interrupts per sample\n");
+    printf(" --reject-noisy = as --noise, and retake samples disturbed by other tasks\n");
+    printf(" --profile = sample the benchmark threads and list the hottest functions\n");
+    printf(" --roofline = place every test on a roofline of this host\n");
+    printf(" --trace=<FILE> = write a Chrome/Perfetto trace of the run to <FILE>\n");
+    printf(" --energy  = report joules per iteration from RAPL, where readable\n");
+    printf(" --cold    = also time every test with the caches evicted before each iteration\n");
+    printf(" --fresh-data = also time every test with new input data every iteration\n");
+    printf(" --warmup=<SECS> = run every test for SECS seconds before scoring it\n");
+    printf(" --warmup-runs=<N> = run every test N times before scoring it\n");
+    printf(" --footprint = report peak RSS, page faults and allocations per test\n");
+    printf(" --isolate = run every test in a child process of its own\n");
+    printf(" --hugepages=<P> = back large buffers with huge pages and compare\n");
+    printf(" --align-sweep = rerun every test with its buffers at several page offsets\n");
+    printf(" --prefetch-sweep = time strided, backward and multi-stream walks of a large array\n");
+    printf(" --memmove=<M> = MoveMemory implementation used by all tests\n");
+    printf(" --randgen=<G> = generator of the input data; SPLITMIX builds it in parallel\n");
+    printf(" --init-threads=<N> = threads building large input data (SPLITMIX)\n");
     exit(0);
 }
 
@@ -574,7 +900,7 @@ static void read_comfile(FILE *cfile)
 
             case PF_CUSTOMRUN:      /* CUSTOMRUN */
                 global_custrun=getflag(eptr);
-                for(i=0;i<NUMTESTS;i++)
+                for(i=0;i<NUMINDEXTESTS;i++)
                     tests_to_do[i]=1-global_custrun;
                 break;
 
@@ -758,9 +1084,174 @@ static void read_comfile(FILE *cfile)
                     (ulong)atol(eptr);
                 break;
 
+            case PF_DOSTREAM:       /* DOSTREAM */
+                tests_to_do[TF_STREAM]=getflag(eptr);
+                break;
+
+            case PF_STREAMASIZE:    /* STREAMARRAYSIZE */
+                global_streamstruct.arraysize=
+                    (ulong)atol(eptr);
+                break;
+
+            case PF_STREAMMINS:     /* STREAMMINSECONDS */
+                global_streamstruct.request_secs=
+                    (ulong)atol(eptr);
+                break;
+
+            case PF_DOLATENCY:      /* DOLATENCY */
+                tests_to_do[TF_LATENCY]=getflag(eptr);
+                break;
+
+            case PF_LATENCYASIZE:   /* LATENCYARRAYSIZE */
+                global_latencystruct.arraysize=
+                    (ulong)atol(eptr);
+                break;
+
+            case PF_LATENCYMAX:     /* LATENCYMAXSIZE */
+                global_latencymax=(ulong)atol(eptr);
+                break;
+
+            case PF_LATENCYMINS:    /* LATENCYMINSECONDS */
+                global_latencystruct.request_secs=
+                    (ulong)atol(eptr);
+                break;
+
             case PF_ALIGN:          /* ALIGN */
                 global_align=atoi(eptr);
                 break;
+
+            case PF_TOPDOWN:        /* TOPDOWN */
+                global_topdown=getflag(eptr);
+                break;
+
+            case PF_FREQMON:        /* FREQMON */
+                global_freqmon=getflag(eptr);
+                break;
+
+            case PF_NOISEMON:       /* NOISEMON */
+                global_noisemon=getflag(eptr);
+                break;
+
+            case PF_NOISEREJECT:    /* NOISEREJECT */
+                global_noisereject=getflag(eptr);
+                break;
+
+            case PF_PROFILE:        /* PROFILE */
+                global_profile=getflag(eptr);
+                break;
+
+            case PF_ROOFLINE:       /* ROOFLINE */
+                global_roofline=getflag(eptr);
+                break;
+
+            case PF_ENERGY:         /* ENERGY */
+                global_energy=getflag(eptr);
+                break;
+
+            case PF_COLD:           /* COLD */
+                global_cold=getflag(eptr);
+                break;
+
+            case PF_FRESHDATA:      /* FRESHDATA */
+                global_freshcheck=getflag(eptr);
+                break;
+
+            case PF_WARMUP:         /* WARMUP */
+                global_warmup_secs=(ulong)atol(eptr);
+                break;
+
+            case PF_WARMUPRUNS:     /* WARMUPRUNS */
+                global_warmup_runs=(ulong)atol(eptr);
+                break;
+
+            case PF_FOOTPRINT:      /* FOOTPRINT */
+                global_footprint=getflag(eptr);
+                break;
+
+            case PF_ISOLATE:        /* ISOLATE */
+                global_isolate=getflag(eptr);
+                break;
+
+            case PF_HUGEPAGES:      /* HUGEPAGES */
+                global_hugepages=gethuge(eptr);
+                break;
+
+            case PF_ALIGNSWEEP:     /* ALIGNSWEEP */
+                global_alignsweep=getflag(eptr);
+                break;
+
+            case PF_PREFETCH:       /* PREFETCHSWEEP */
+                global_prefetch=getflag(eptr);
+                break;
+
+            case PF_PREFETCHASIZE:  /* PREFETCHARRAYSIZE */
+                global_prefetchsize=(ulong)atol(eptr);
+                break;
+
+            case PF_PREFETCHSTRIDE: /* PREFETCHSTRIDE */
+                global_prefetchstride=(ulong)atol(eptr);
+                break;
+
+            case PF_MEMMOVE:        /* MEMMOVE */
+                global_movemem=getmove(eptr);
+                break;
+
+            case PF_RANDGEN:        /* RANDGEN */
+                global_randgen=getrandgen(eptr);
+                break;
+
+            case PF_INITTHREADS:    /* INITTHREADS */
+                global_initthreads=atoi(eptr);
+                break;
+
+            case PF_DOMEMMOVE:      /* DOMEMMOVE */
+                tests_to_do[TF_MEMMOVE]=getflag(eptr);
+                break;
+
+            case PF_MEMMOVESIZE:    /* MEMMOVESIZE */
+                global_memmovestruct.arraysize=
+                    (ulong)atol(eptr);
+                break;
+
+            case PF_MEMMOVEMINS:    /* MEMMOVEMINSECONDS */
+                global_memmovestruct.request_secs=
+                    (ulong)atol(eptr);
+                break;
+
+            case PF_DOCHURN:        /* DOCHURN */
+                tests_to_do[TF_CHURN]=getflag(eptr);
+                break;
+
+            case PF_CHURNLIVE:      /* CHURNLIVE */
+                global_churnstruct.arraysize=
+                    (ulong)atol(eptr);
+                break;
+
+            case PF_CHURNMINS:      /* CHURNMINSECONDS */
+                global_churnstruct.request_secs=
+                    (ulong)atol(eptr);
+                break;
+
+            case PF_DOFAULT:        /* DOFAULT */
+                tests_to_do[TF_FAULT]=getflag(eptr);
+                break;
+
+            case PF_FAULTSIZE:      /* FAULTSIZE */
+                global_faultstruct.arraysize=
+                    (ulong)atol(eptr);
+                break;
+
+            case PF_FAULTMINS:      /* FAULTMINSECONDS */
+                global_faultstruct.request_secs=
+                    (ulong)atol(eptr);
+                break;
+
+            case PF_TRACEFILE:      /* TRACEFILE */
+                if(strlen(eptr)<TRACEFILELEN)
+                {   strcpy(global_tracefile,eptr);
+                    global_trace=1;
+                }
+                break;
         }
 skipswitch:
         continue;
@@ -780,6 +1271,57 @@ static int getflag(char *cptr)
     return(0);
 }
 
+/************
+** gethuge **
+*************
+** Return the page policy (HUGE_xxx) named by cptr: "THP",
+** "2M" or "1G"; anything else is HUGE_OFF.
+*/
+static int gethuge(char *cptr)
+{
+    switch(toupper((int)*cptr))
+    {
+        case 'T': return(HUGE_THP);
+        case '2': return(HUGE_2M);
+        case '1': return(HUGE_1G);
+    }
+    return(HUGE_OFF);
+}
+
+/************
+** getmove **
+*************
+** Return the MoveMemory implementation (MOVE_xxx) named by
+** cptr, in any case; anything unknown is MOVE_LIBC.
+*/
+static int getmove(char *cptr)
+{
+    int i;
+    size_t j;
+    char name[16];
+
+    for(j=0;j<sizeof(name)-1 && cptr[j]!='\0' && !isspace((int)cptr[j]);j++)
+        name[j]=(char)tolower((int)cptr[j]);
+    name[j]='\0';
+    for(i=0;i<MOVEKINDS;i++)
+        if(strcmp(name,movenames[i])==0)
+            return(i);
+    return(MOVE_LIBC);
+}
+
+/***************
+** getrandgen **
+****************
+** Return the input data generator (RAND_xxx) named by cptr:
+** "SPLITMIX"; anything else is RAND_LCG.
+*/
+static int getrandgen(char *cptr)
+{
+    if(toupper((int)*cptr)=='S')
+        return(RAND_SPLITMIX);
+    return(RAND_LCG);
+}
+
 /***************
 ** strtoupper **
 ****************
@@ -823,6 +1365,11 @@ static void set_request_secs(void)
     global_huffstruct.request_secs=global_min_seconds;
     global_nnetstruct.request_secs=global_min_seconds;
     global_lustruct.request_secs=global_min_seconds;
+    global_streamstruct.request_secs=global_min_seconds;
+    global_latencystruct.request_secs=global_min_seconds;
+    global_memmovestruct.request_secs=global_min_seconds;
+    global_churnstruct.request_secs=global_min_seconds;
+    global_faultstruct.request_secs=global_min_seconds;
 
     return;
 }
@@ -854,15 +1401,23 @@ static int bench_with_confidence(int fid,       /* Function id */
     double myscores[30];            /* Need at least 5 scores, use at most 30 */
     double c_half_interval;         /* Confidence half interval */
     int i;                          /* Index */
+    TestControlStruct *testctl;     /* Control structure of this test */
     /* double newscore; */          /* For improving confidence interval */
 
+    /*
+     ** Counter totals cover the scored runs only.
+     */
+    testctl=(TestControlStruct *)global_fstruct[fid];
+    for (i=0;i<MAXPERFCOUNTERS;i++)
+        testctl->perfcount[i]=(double)0.0;
+    rejected_samples=0;
+
     /*
      ** Get first 5 scores.  Then begin confidence testing.
      */
     for (i=0;i<5;i++)
     {
-        (*funcpointer[fid])();
-        myscores[i]=getscore(fid);
+        myscores[i]=run_sample(fid,&samples[i]);
 #ifdef DEBUG
         printf("score # %d = %g\n", i, myscores[i]);
 #endif
@@ -917,8 +1472,7 @@ static int bench_with_confidence(int fid,       /* Function id */
         /* We now simply add a new test run and hope that the runs
            finally stabilize, Uwe F. Mayer */
         if(*numtries==30) return(-1);
-        (*funcpointer[fid])();
-        myscores[*numtries]=getscore(fid);
+        myscores[*numtries]=run_sample(fid,&samples[*numtries]);
 #ifdef DEBUG
         printf("score # %ld = %g\n", *numtries, myscores[*numtries]);
 #endif
@@ -1041,26 +1595,299 @@ static int calc_confidence(double scores[], /* Array of scores */
     return(0);
 }
 
-/*************
-** getscore **
-**************
-** Return the score for a particular benchmark.
+/***************
+** run_sample **
+****************
+** Run benchmark fid once and return its score.  Also folds
+** the run's hardware counter totals into the test's
+** control structure, and records the score, the clock and
+** the outside activity the run saw in sample.  With
+** NOISEREJECT set, disturbed runs are retaken (up to
+** MAXREJECTS per test) and do not count.
 */
-static double getscore(int fid)
+static double run_sample(int fid, SampleStruct *sample)
 {
+    TestControlStruct *testctl;
+    FreqSampleStruct fs;
+    int i;
 
-    /*
-     ** Fid tells us the function.  This is really a matter of
-     ** doing the proper coercion.
-     */
-    switch(fid)
+    testctl=(TestControlStruct *)global_fstruct[fid];
+    TraceTest(ftestnames[fid]);
+    while(1)
     {
-        case TF_NUMSORT:
-            return(global_numsortstruct.realrate);
-        case TF_SSORT:
-            return(global_strsortstruct.realrate);
-        case TF_BITOP:
-            return(global_bitopstruct.realrate);
+        TraceSampleBegin();
+        if(global_energy)
+            EnergyTimedReset();
+        if(global_freqmon)
+            FreqSampleBegin(&fs);
+        if(global_noisemon)
+            NoiseSampleBegin(&sample->noise);
+        (*funcpointer[fid])();
+        if(global_noisemon)
+            NoiseSampleEnd(&sample->noise);
+        if(global_freqmon)
+            FreqSampleEnd(&fs);
+        if(global_energy)
+            EnergyTimed(&sample->energy);
+        TraceSampleEnd(getscore(fid));
+
+        if(!global_noisereject || !sample->noise.disturbed ||
+                rejected_samples>=MAXREJECTS)
+            break;
+        rejected_samples++;
+    }
+
+    for (i=0;i<MAXPERFCOUNTERS;i++)
+        testctl->perfcount[i]+=testctl->result.perfcount[i];
+    sample->score=getscore(fid);
+    sample->iterations=testctl->result.iterations;
+
+    if(global_freqmon)
+    {
+        /*
+         ** APERF over thread CPU time is the clock the benchmark
+         ** threads actually ran at; cpufreq is only a snapshot.
+         */
+        sample->ghz=fs.khz*1e-6;
+        if(testctl->result.perfcount[PERF_APERF]>(double)0.0 &&
+                testctl->result.cpusecs>(double)0.0)
+            sample->ghz=testctl->result.perfcount[PERF_APERF]/
+                testctl->result.cpusecs*1e-9;
+        sample->temp=fs.temp;
+        sample->throttled=fs.throttled;
+    }
+    return(sample->score);
+}
+
+/*************
+** run_test **
+**************
+** Benchmark test i and display its result line and whatever
+** else was asked for.  Returns the mean score, from which main
+** builds the indexes.
+*/
+static double run_test(int i)
+{
+    double bmean;           /* Benchmark mean */
+    double bstdev;          /* Benchmark stdev */
+    ulong bnumrun;          /* # of runs */
+    int uncertain;          /* Test missed the confidence criterion */
+    FootprintStruct fp;     /* Memory used by the test */
+    char buffer[BUF_SIZ];   /* Buffer for holding output text. */
+
+    mem_huge_blocks=mem_thp_blocks=mem_huge_fallbacks=0;
+    if(global_warmup_secs || global_warmup_runs)
+        warm_up(i);
+    if(global_profile)
+        ProfReset();
+    if(global_footprint)
+        FootprintBegin(&fp);
+    uncertain=bench_with_confidence(i,
+                &bmean,
+                &bstdev,
+                &bnumrun);
+    if(global_footprint)
+        FootprintEnd(&fp);
+    if (0!=uncertain){
+        output_string("\n** WARNING: The current test result is NOT 95 % statistically certain.\n");
+        output_string("** WARNING: The variation among the individual results is too large.\n");
+        output_string("                    :");
+    }
+#ifdef LINUX
+    if(i<NUMINDEXTESTS)
+        sprintf(buffer," %15.5g  :  %9.2f  :  %9.2f\n",
+                bmean,bmean/bindex[i],bmean/lx_bindex[i]);
+    else
+        sprintf(buffer," %15.5g  :  %9s  :  %9s\n",bmean,"--","--");
+#else
+    if(i<NUMINDEXTESTS)
+        sprintf(buffer,"  Iterations/sec.: %13.2f  Index: %6.2f\n",
+                bmean,bmean/bindex[i]);
+    else
+        sprintf(buffer,"  Iterations/sec.: %13.2f\n",bmean);
+#endif
+    output_string(buffer);
+    if(i==TF_STREAM)
+        show_stream(bmean);
+    if(i==TF_LATENCY)
+        show_latency(bmean);
+    if(i==TF_MEMMOVE)
+        show_memmove(bmean);
+    if(i==TF_CHURN)
+        show_churn(bmean);
+    if(i==TF_FAULT)
+        show_fault(bmean);
+    if(global_topdown)
+        show_topdown(i);
+    if(global_freqmon)
+        show_freq(bnumrun);
+    if(global_noisemon)
+        show_noise(bnumrun,uncertain);
+    if(global_profile)
+        show_profile();
+    if(global_roofline)
+        show_roofline(i,bmean);
+    if(global_energy)
+        show_energy(bnumrun);
+    if(global_footprint)
+        show_footprint(&fp);
+    if(global_hugepages!=HUGE_OFF)
+        show_hugepages(i,bmean);
+    if(global_alignsweep)
+        show_alignsweep(i,bmean);
+    if(global_warmup_secs || global_warmup_runs)
+        show_warmup(bmean);
+    if(global_cold)
+        show_cold(i,bmean);
+    if(global_freshcheck)
+        show_fresh(i,bmean);
+#ifdef OPCOUNT
+    show_opcount(i,bmean);
+#endif
+    if(global_allstats)
+    {
+        sprintf(buffer,"  Absolute standard deviation: %g\n",bstdev);
+        output_string(buffer);
+        if (bmean>(double)1e-100){
+            /* avoid division by zero */
+            sprintf(buffer,"  Relative standard deviation: %g %%\n",
+                    (double)100*bstdev/bmean);
+            output_string(buffer);
+        }
+        sprintf(buffer,"  Number of runs: %lu\n",bnumrun);
+        output_string(buffer);
+        show_stats(i);
+        sprintf(buffer,"Done with %s\n\n",ftestnames[i]);
+        output_string(buffer);
+    }
+    return(bmean);
+}
+
+/******************
+** isolated_test **
+*******************
+** Run run_test(i) in a child process, so that the heap and
+** allocator state left behind by earlier tests cannot affect
+** it, and read its mean score back through a pipe.  The child
+** writes its own output, and its own trace file; the parent
+** only waits for it.
+*/
+static double isolated_test(int i)
+{
+    double bmean;           /* Benchmark mean */
+#ifdef LINUX
+    char reason[80];        /* Why tracing failed */
+    char buffer[BUF_SIZ];   /* Display buffer */
+    int fd[2];
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    if(write_to_file!=0)
+        fflush(global_ofile);
+    if(pipe(fd)!=0)
+    {   printf("ERROR: cannot create pipe for isolated test\n");
+        ErrorExit();
+    }
+    pid=fork();
+    if(pid<0)
+    {   printf("ERROR: cannot fork isolated test\n");
+        ErrorExit();
+    }
+    if(pid==0)
+    {
+        close(fd[0]);
+        if(TraceChild(i,reason)!=0)
+        {   sprintf(buffer,"** Trace unavailable: %s: %s.%d\n",reason,
+              global_tracefile,i);
+            output_string(buffer);
+        }
+        bmean=run_test(i);
+        TraceClose();
+        fflush(stdout);
+        if(write_to_file!=0)
+            fflush(global_ofile);
+        if(write(fd[1],&bmean,sizeof(bmean))!=sizeof(bmean))
+            _exit(1);
+        _exit(0);
+    }
+    close(fd[1]);
+    if(read(fd[0],&bmean,sizeof(bmean))!=sizeof(bmean))
+        bmean=(double)0.0;
+    close(fd[0]);
+    while(waitpid(pid,&status,0)<0 && errno==EINTR)
+        ;
+    if(bmean<=(double)0.0)
+    {   printf("\nERROR: isolated %s did not report a result\n",ftestnames[i]);
+        ErrorExit();
+    }
+#else
+    bmean=run_test(i);
+#endif
+    return(bmean);
+}
+
+/************
+** warm_up **
+*************
+** Run test fid until it has been timed for global_warmup_secs
+** seconds and run global_warmup_runs times, whichever takes
+** longer, so that the scored samples start from steady state.
+** The first run of a test also does its calibration.  Each run
+** is a single pass; the results go to warmup, not to the
+** statistics.
+*/
+static void warm_up(int fid)
+{
+    TestControlStruct *testctl;
+    ulong savesecs;
+    double score;
+
+    testctl=(TestControlStruct *)global_fstruct[fid];
+    savesecs=testctl->request_secs;
+    testctl->request_secs=0;
+    TraceTest(ftestnames[fid]);
+    memset(&warmup,0,sizeof(WarmupStruct));
+    while(warmup.runs<MAXWARMUP &&
+            (warmup.runs<global_warmup_runs ||
+             warmup.secs<(double)global_warmup_secs))
+    {
+        TraceSampleBegin();
+        (*funcpointer[fid])();
+        score=getscore(fid);
+        TraceSampleEnd(score);
+        if(warmup.runs==0)
+            warmup.first=warmup.min=warmup.max=score;
+        if(score<warmup.min) warmup.min=score;
+        if(score>warmup.max) warmup.max=score;
+        warmup.last=score;
+        warmup.secs+=testctl->result.realsecs;
+        warmup.runs++;
+    }
+    testctl->request_secs=savesecs;
+    return;
+}
+
+/*************
+** getscore **
+**************
+** Return the score for a particular benchmark.
+*/
+static double getscore(int fid)
+{
+
+    /*
+     ** Fid tells us the function.  This is really a matter of
+     ** doing the proper coercion.
+     */
+    switch(fid)
+    {
+        case TF_NUMSORT:
+            return(global_numsortstruct.realrate);
+        case TF_SSORT:
+            return(global_strsortstruct.realrate);
+        case TF_BITOP:
+            return(global_bitopstruct.realrate);
         case TF_FPEMU:
             return(global_emfloatstruct.realrate);
         case TF_FFPU:
@@ -1075,6 +1902,16 @@ static double getscore(int fid)
             return(global_nnetstruct.realrate);
         case TF_LU:
             return(global_lustruct.realrate);
+        case TF_STREAM:
+            return(global_streamstruct.realrate);
+        case TF_LATENCY:
+            return(global_latencystruct.realrate);
+        case TF_MEMMOVE:
+            return(global_memmovestruct.realrate);
+        case TF_CHURN:
+            return(global_churnstruct.realrate);
+        case TF_FAULT:
+            return(global_faultstruct.realrate);
     }
     return((double)0.0);
 }
@@ -1185,10 +2022,1137 @@ static void show_stats (int bid)
                     global_lustruct.numarrays);
             output_string(buffer);
             break;
+
+        case TF_STREAM:
+            sprintf(buffer,"  Array size: %lu doubles\n",
+                    global_streamstruct.arraysize);
+            output_string(buffer);
+            break;
+
+        case TF_LATENCY:
+            sprintf(buffer,"  Chain size: %lu bytes\n",
+                    global_latencystruct.arraysize);
+            output_string(buffer);
+            break;
+
+        case TF_MEMMOVE:
+            sprintf(buffer,"  Move size: %lu bytes, %s\n",
+                    global_memmovestruct.arraysize,movenames[global_movemem]);
+            output_string(buffer);
+            break;
+
+        case TF_CHURN:
+            sprintf(buffer,"  Live blocks: %lu per thread\n",
+                    global_churnstruct.arraysize);
+            output_string(buffer);
+            break;
+
+        case TF_FAULT:
+            sprintf(buffer,"  Region size: %lu bytes, %s pages\n",
+                    global_faultstruct.arraysize,
+                    global_hugepages!=HUGE_OFF ? "huge" : "4 KB");
+            output_string(buffer);
+            break;
     }
     return;
 }
 
+/*****************
+** show_topdown **
+******************
+** Display the top-down breakdown of a benchmark, built from
+** the counters collected over all of its scored runs.
+*/
+static void show_topdown(int bid)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    TopdownStruct td;       /* Breakdown */
+
+    if(PerfTopdown(((TestControlStruct *)global_fstruct[bid])->perfcount,&td)!=0)
+    {
+        output_string("  Top-down: unavailable\n");
+        return;
+    }
+    sprintf(buffer,"  Top-down L1: retiring %.1f%%  bad speculation %.1f%%  frontend %.1f%%  backend %.1f%%\n",
+            100.0*td.retiring,100.0*td.badspec,100.0*td.frontend,100.0*td.backend);
+    output_string(buffer);
+    if(td.membound>=(double)0.0)
+    {
+        sprintf(buffer,"  Top-down L2: backend memory %.1f%%  backend core %.1f%%",
+                100.0*td.membound,100.0*td.corebound);
+        output_string(buffer);
+        if(td.brmispredict>=(double)0.0)
+        {
+            sprintf(buffer,"  branch mispredict %.1f%%",100.0*td.brmispredict);
+            output_string(buffer);
+        }
+        if(td.fetchlat>=(double)0.0)
+        {
+            sprintf(buffer,"  fetch latency %.1f%%",100.0*td.fetchlat);
+            output_string(buffer);
+        }
+        if(td.heavyops>=(double)0.0)
+        {
+            sprintf(buffer,"  heavy ops %.1f%%",100.0*td.heavyops);
+            output_string(buffer);
+        }
+        output_string("\n");
+    }
+    else
+        output_string("  Top-down L2: unavailable on this CPU\n");
+    return;
+}
+
+/**************
+** show_freq **
+***************
+** Display the clock the samples of the last test ran at,
+** the throughput per GHz, and how many samples were taken
+** while the CPU was throttled.  In verbose mode each sample
+** is listed as well.
+*/
+static void show_freq(ulong numtries)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    double ghz, pergHz, temp;
+    int i, n, throttled;
+
+    ghz=pergHz=temp=(double)0.0;
+    n=throttled=0;
+    for(i=0;i<(int)numtries;i++)
+    {
+        if(samples[i].ghz>(double)0.0)
+        {   ghz+=samples[i].ghz;
+            pergHz+=samples[i].score/samples[i].ghz;
+            n++;
+        }
+        if(samples[i].temp>temp) temp=samples[i].temp;
+        throttled+=samples[i].throttled;
+        if(global_allstats)
+        {
+            sprintf(buffer,"  Sample %2d: %12.5g iter/s",i+1,samples[i].score);
+            output_string(buffer);
+            if(samples[i].ghz>(double)0.0)
+            {   sprintf(buffer,"  %6.3f GHz  %12.5g iter/s/GHz",
+                        samples[i].ghz,samples[i].score/samples[i].ghz);
+                output_string(buffer);
+            }
+            if(samples[i].temp>(double)0.0)
+            {   sprintf(buffer,"  %5.1f C",samples[i].temp);
+                output_string(buffer);
+            }
+            output_string(samples[i].throttled ? "  THROTTLED\n" : "\n");
+        }
+    }
+
+    if(n)
+    {
+        sprintf(buffer,"  Clock: %.3f GHz (%s)  Iterations/sec. per GHz: %.5g\n",
+                ghz/(double)n,PerfHasAperf() ? "APERF/MPERF" : "cpufreq",
+                pergHz/(double)n);
+        output_string(buffer);
+    }
+    else
+        output_string("  Clock: unavailable\n");
+    sprintf(buffer,"  Throttled samples: %d of %lu",throttled,numtries);
+    output_string(buffer);
+    if(temp>(double)0.0)
+    {   sprintf(buffer,"  Peak temperature: %.1f C",temp);
+        output_string(buffer);
+    }
+    output_string("\n");
+    return;
+}
+
+/***************
+** show_noise **
+****************
+** Display the outside activity seen during the samples of
+** the last test and how many samples it disturbed.  If the
+** test missed the confidence criterion, say whether noise
+** or the host itself is the likelier cause.  In verbose mode
+** each sample is listed as well.
+*/
+static void show_noise(ulong numtries, int uncertain)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    NoiseSampleStruct *ns;
+    long ivcsw, migr, majflt, irq;
+    double secs;
+    int i, disturbed;
+
+    ivcsw=migr=majflt=irq=0;
+    secs=(double)0.0;
+    disturbed=0;
+    for(i=0;i<(int)numtries;i++)
+    {
+        ns=&samples[i].noise;
+        ivcsw+=ns->nivcsw;
+        migr+=ns->migrations;
+        majflt+=ns->majflt;
+        irq+=ns->interrupts;
+        secs+=ns->secs;
+        disturbed+=ns->disturbed;
+        if(global_allstats)
+        {
+            sprintf(buffer,"  Sample %2d: %12.5g iter/s  cs %ld/%ld  migr %ld  flt %ld/%ld  irq %ld%s\n",
+                    i+1,samples[i].score,ns->nvcsw,ns->nivcsw,ns->migrations,
+                    ns->minflt,ns->majflt,ns->interrupts,
+                    ns->disturbed ? "  DISTURBED" : "");
+            output_string(buffer);
+        }
+    }
+
+    sprintf(buffer,"  Noise: %d of %lu samples disturbed (%ld preemptions, %ld migrations, %ld major faults, %.0f irq/s)\n",
+            disturbed,numtries,ivcsw,migr,majflt,
+            secs>(double)0.0 ? (double)irq/secs : (double)0.0);
+    output_string(buffer);
+    if(rejected_samples)
+    {   sprintf(buffer,"  Rejected samples: %d\n",rejected_samples);
+        output_string(buffer);
+    }
+    if(uncertain)
+        output_string(disturbed ?
+                "  Variation coincides with outside activity: the host is noisy.\n" :
+                "  No outside activity seen: the variation comes from the test or the CPU.\n");
+    return;
+}
+
+/*****************
+** show_profile **
+******************
+** Display the functions the benchmark threads of the last
+** test spent most of their CPU time in, from the profiler's
+** samples.  This includes the untimed data setup.
+*/
+static void show_profile(void)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    ProfEntryStruct top[8];
+    long total, lost;
+    int i, n;
+
+    n=ProfTop(top,8,&total,&lost);
+    if(total==0)
+    {   output_string("  Profile: no samples\n");
+        return;
+    }
+    sprintf(buffer,"  Profile: %ld samples",total);
+    output_string(buffer);
+    if(lost)
+    {   sprintf(buffer," (%ld lost)",lost);
+        output_string(buffer);
+    }
+    output_string("\n");
+    for(i=0;i<n;i++)
+    {
+        sprintf(buffer,"    %5.1f %%  %s\n",
+                (double)100*(double)top[i].hits/(double)total,top[i].name);
+        output_string(buffer);
+    }
+    return;
+}
+
+/******************
+** roofline_work **
+*******************
+** Work one iteration of test fid does, worked out from its
+** parameters: *bytes is the memory traffic the kernel can't
+** avoid (every datum read and written once), *ops the
+** operations it performs.  *isflop is set if these are
+** floating-point operations.  Calls to pow(), sin() and cos()
+** count as one operation each.  Returns -1 for tests whose
+** work depends on the data (ASSIGNMENT, NEURAL NET); *bytes
+** is still set for those.
+*/
+static int roofline_work(int fid, double *bytes, double *ops, int *isflop)
+{
+    double n, m, lg;
+
+    *isflop=0;
+    *ops=(double)0.0;
+    switch(fid)
+    {
+        case TF_NUMSORT:
+            /*
+             ** Heapsort: about 2n log n compares and n log n swaps.
+             */
+            n=(double)global_numsortstruct.arraysize;
+            lg=log(n)/log((double)2.0);
+            *ops=(double)3.0*n*lg;
+            *bytes=(double)2.0*n*(double)sizeof(long);
+            return(0);
+        case TF_SSORT:
+            /*
+             ** Strings average 38.5 characters plus a length byte.
+             */
+            n=(double)global_strsortstruct.arraysize;
+            m=n/(double)39.5;
+            lg=log(m)/log((double)2.0);
+            *ops=(double)3.0*m*lg;
+            *bytes=(double)2.0*(n+m*(double)sizeof(ulong));
+            return(0);
+        case TF_BITOP:
+            /*
+             ** One iteration is one bit; its word is read and written.
+             */
+            *ops=(double)1.0;
+            *bytes=(double)2.0/(double)8.0;
+            return(0);
+        case TF_FPEMU:
+            /*
+             ** One emulated operation per element; two 12-byte
+             ** operands read, one result written.
+             */
+            n=(double)global_emfloatstruct.arraysize;
+            *ops=n;
+            *bytes=(double)3.0*n*(double)12.0;
+            return(0);
+        case TF_FFPU:
+            /*
+             ** One coefficient: 200 trapezoid steps of pow(),
+             ** sin() or cos() and three arithmetic operations.
+             */
+            *isflop=1;
+            *ops=(double)200.0*(double)5.0;
+            *bytes=(double)sizeof(double);
+            return(0);
+        case TF_ASSIGN:
+            *bytes=(double)2.0*(double)101*(double)101*(double)sizeof(long)+
+                (double)101*(double)101*(double)sizeof(short);
+            return(-1);
+        case TF_IDEA:
+            /*
+             ** Encrypt and decrypt the array: 8 rounds of 14
+             ** operations plus a 4-operation output transform
+             ** per 8-byte block.
+             */
+            n=(double)global_ideastruct.arraysize;
+            *ops=(double)2.0*(n/(double)8.0)*(double)116.0;
+            *bytes=(double)4.0*n;
+            return(0);
+        case TF_HUFF:
+            /*
+             ** Histogram, then encode and decode at about 4.3
+             ** bits per character of the generated text.
+             */
+            n=(double)global_huffstruct.arraysize;
+            *ops=n+(double)2.0*(double)4.3*n;
+            *bytes=(double)3.0*n+(double)2.0*(double)4.3*n/(double)8.0;
+            return(0);
+        case TF_NNET:
+            /*
+             ** Weights and their changes; the number of training
+             ** passes depends on the random start.
+             */
+            *isflop=1;
+            *bytes=(double)2.0*(double)(35*8+8*8)*(double)2.0*(double)sizeof(double);
+            return(-1);
+        case TF_LU:
+            /*
+             ** Decomposition plus back substitution of a 101x101
+             ** system.
+             */
+            *isflop=1;
+            n=(double)101.0;
+            *ops=(double)2.0*n*n*n/(double)3.0+(double)2.0*n*n;
+            *bytes=(double)2.0*(n*n+n)*(double)sizeof(double);
+            return(0);
+        case TF_STREAM:
+            /*
+             ** Copy, scale, add and triad: 10 doubles moved and
+             ** 4 flops per element.
+             */
+            *isflop=1;
+            n=(double)global_streamstruct.arraysize;
+            *ops=(double)4.0*n;
+            *bytes=(double)80.0*n;
+            return(0);
+        case TF_LATENCY:
+            /*
+             ** One load, one cache line.
+             */
+            *ops=(double)1.0;
+            *bytes=(double)LATENCYLINE;
+            return(0);
+        case TF_MEMMOVE:
+            /*
+             ** One move: every byte read and written; the
+             ** operation is the byte moved.
+             */
+            n=(double)global_memmovestruct.arraysize;
+            *ops=n;
+            *bytes=(double)2.0*n;
+            return(0);
+        case TF_CHURN:
+            /*
+             ** One free and one allocation; the new block's
+             ** first line and last byte are written.
+             */
+            *ops=(double)1.0;
+            *bytes=(double)128.0;
+            return(0);
+        case TF_FAULT:
+            /*
+             ** Every 4 KB faulted in twice, and zeroed by the
+             ** kernel each time; the operation is the fault.
+             */
+            n=(double)global_faultstruct.arraysize;
+            *ops=(double)2.0*n/(double)OFFSET_PAGE;
+            *bytes=(double)2.0*n;
+            return(0);
+    }
+    *bytes=(double)0.0;
+    return(-1);
+}
+
+/******************
+** show_roofline **
+*******************
+** Display where test fid sits on the roofline of this host:
+** its arithmetic intensity, the bandwidth and operation rate it
+** achieved at score iterations/sec., and which roof bounds it.
+** The compute roof is scaled by the number of threads; the
+** bandwidth roof was measured on that many threads.
+*/
+static void show_roofline(int fid, double score)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    double bytes, ops, peak, ridge, intensity, attainable;
+    int isflop;
+
+    if(roofline_work(fid,&bytes,&ops,&isflop)!=0)
+    {
+        sprintf(buffer,"  Roofline: %.3g GB/s; operation count depends on the data\n",
+                bytes*score*1e-9);
+        output_string(buffer);
+        return;
+    }
+    peak=(isflop ? roof.gflops : roof.giops)*(double)global_concurrency;
+    intensity=ops/bytes;
+    sprintf(buffer,"  Roofline: %.3g %s/byte  %.3g GB/s  %.3g %s/s",
+            intensity,isflop ? "flop" : "op",bytes*score*1e-9,
+            ops*score*1e-9,isflop ? "GFLOP" : "Gop");
+    output_string(buffer);
+    if(roof.gbs>(double)0.0 && peak>(double)0.0)
+    {
+        ridge=peak/roof.gbs;
+        attainable=intensity<ridge ? intensity*roof.gbs : peak;
+        sprintf(buffer,"  under %s roof (ridge %.3g), at %.0f %% of it",
+                intensity<ridge ? "memory" : "compute",ridge,
+                (double)100*ops*score*1e-9/attainable);
+        output_string(buffer);
+    }
+    output_string("\n");
+    return;
+}
+
+/****************
+** show_energy **
+*****************
+** Display the package (and DRAM) energy used by the samples of
+** the last test, per iteration and as iterations per joule.
+** The energy covers the whole package, but only while at least
+** one benchmark thread was in a timed region.
+*/
+static void show_energy(ulong numtries)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    double pkg, dram, iters;
+    int i;
+
+    if(!EnergyAvailable())
+    {   output_string("  Energy: unavailable\n");
+        return;
+    }
+    pkg=dram=iters=(double)0.0;
+    for(i=0;i<(int)numtries;i++)
+    {   pkg+=samples[i].energy.pkg;
+        dram+=samples[i].energy.dram;
+        iters+=samples[i].iterations;
+    }
+    if(pkg<=(double)0.0 || iters<=(double)0.0)
+    {   output_string("  Energy: no reading\n");
+        return;
+    }
+    sprintf(buffer,"  Energy: %.4g J/iteration, %.4g iterations/J (package %.1f J",
+            pkg/iters,iters/pkg,pkg);
+    output_string(buffer);
+    if(samples[0].energy.dram>=(double)0.0)
+    {   sprintf(buffer,", DRAM %.1f J, %.4g J/iteration",dram,dram/iters);
+        output_string(buffer);
+    }
+    output_string(")\n");
+    return;
+}
+
+/****************
+** rerun_score **
+*****************
+** Run test fid numruns more times, each for secs seconds (0
+** for a single pass), and return the mean score.  The caller
+** sets up whatever condition the runs are meant to measure.
+*/
+static double rerun_score(int fid, ulong secs, int numruns)
+{
+    TestControlStruct *testctl;
+    ulong savesecs;
+    double score;
+    int i;
+
+    testctl=(TestControlStruct *)global_fstruct[fid];
+    savesecs=testctl->request_secs;
+    testctl->request_secs=secs;
+    score=(double)0.0;
+    for(i=0;i<numruns;i++)
+    {   (*funcpointer[fid])();
+        score+=getscore(fid);
+    }
+    testctl->request_secs=savesecs;
+    return(score/(double)numruns);
+}
+
+/*******************
+** show_footprint **
+********************
+** Display the memory footprint of the last test.
+*/
+static void show_footprint(FootprintStruct *fp)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+
+    sprintf(buffer,"  Memory: %lu blocks, %.4g MB allocated, %.4g MB at peak\n",
+            fp->allocs,fp->allocbytes/1048576.0,fp->peakbytes/1048576.0);
+    output_string(buffer);
+#ifdef LINUX
+    sprintf(buffer,"  Memory: peak RSS %.4g MB%s; %ld minor, %ld major faults\n",
+            fp->peakrss/1024.0,fp->rssreset ? "" : " (whole run)",
+            fp->minflt,fp->majflt);
+    output_string(buffer);
+#endif
+    return;
+}
+
+/*******************
+** show_hugepages **
+********************
+** Run test fid once more on normal pages and display its rate
+** and data TLB misses next to those of the scored runs, score
+** being their mean.  Tests whose blocks are all smaller than
+** HUGE_MINBYTES are not rerun.  Blocks given transparent huge
+** pages are only advised to use them; khugepaged or the fault
+** path may still leave them on 4 KB pages, so they are shown
+** as THP-advised.
+*/
+static void show_hugepages(int fid, double score)
+{
+    static char *policies[] = { "off", "THP", "2M", "1G" };
+    char buffer[BUF_SIZ];   /* Display buffer */
+    TestControlStruct *testctl;
+    ulong blocks, thp, fallbacks;
+    double misses, small;
+    int policy;
+
+    thp=mem_thp_blocks;
+    blocks=mem_huge_blocks+thp;
+    fallbacks=mem_huge_fallbacks;
+    testctl=(TestControlStruct *)global_fstruct[fid];
+    misses=(double)-1.0;
+    if(PerfHasTlb() && testctl->perfcount[PERF_DTLBLOADS]>(double)0.0)
+        misses=testctl->perfcount[PERF_DTLBMISSES];
+
+    if(blocks==0 && fallbacks==0)
+    {   output_string("  Huge pages: no buffer large enough\n");
+        return;
+    }
+    policy=global_hugepages;
+    global_hugepages=HUGE_OFF;
+    small=rerun_score(fid,(ulong)global_min_seconds,1);
+    global_hugepages=policy;
+
+    sprintf(buffer,"  Huge pages (%s): %.5g iterations/sec",policies[policy],score);
+    output_string(buffer);
+    if(misses>=(double)0.0)
+    {   sprintf(buffer,", %.4g dTLB misses per 1000 loads",
+                (double)1000.0*misses/testctl->perfcount[PERF_DTLBLOADS]);
+        output_string(buffer);
+    }
+    if(fallbacks>0)
+    {   sprintf(buffer," (%lu of %lu blocks not on %s pages)",
+                fallbacks,blocks+fallbacks,policies[policy]);
+        output_string(buffer);
+    }
+    if(thp>0)
+    {   sprintf(buffer," (%lu of %lu blocks THP-advised)",
+                thp,blocks+fallbacks);
+        output_string(buffer);
+    }
+    output_string("\n");
+    sprintf(buffer,"  Normal pages: %.5g iterations/sec",small);
+    output_string(buffer);
+    if(misses>=(double)0.0 && testctl->result.perfcount[PERF_DTLBLOADS]>(double)0.0)
+    {   sprintf(buffer,", %.4g dTLB misses per 1000 loads",
+                (double)1000.0*testctl->result.perfcount[PERF_DTLBMISSES]/
+                testctl->result.perfcount[PERF_DTLBLOADS]);
+        output_string(buffer);
+    }
+    if(small>(double)0.0)
+    {   sprintf(buffer," (huge pages %+.1f %%)",(double)100.0*(score/small-1.0));
+        output_string(buffer);
+    }
+    output_string("\n");
+    return;
+}
+
+/********************
+** show_alignsweep **
+*********************
+** Rerun test fid with all of its buffers placed at a series of
+** offsets into a page and display the rate at each, relative
+** to score, the mean of the scored runs.  Offsets 4, 60 and 62
+** misalign the elements, so accesses wider than that cross
+** cache lines and show split-line penalties; the multiples of
+** 8 keep 8-byte elements whole and compare placements in a
+** line and a page.  Equal offsets of many buffers show 4K
+** aliasing; "staggered" moves every block 64 bytes further
+** into its page, which avoids the aliasing.
+*/
+static void show_alignsweep(int fid, double score)
+{
+    static long offsets[] = { 0L, 4L, 8L, 16L, 32L, 60L, 62L, 64L,
+            1024L, 2048L, 4032L, OFFSET_STAGGER };
+    char buffer[BUF_SIZ];   /* Display buffer */
+    double rate;
+    int i;
+
+    for(i=0;i<(int)(sizeof(offsets)/sizeof(offsets[0]));i++)
+    {
+        global_offset=offsets[i];
+        rate=rerun_score(fid,(ulong)1,1);
+        global_offset=OFFSET_NONE;
+        if(offsets[i]==OFFSET_STAGGER)
+            sprintf(buffer,"  Offset staggered: %13.5g iterations/sec",rate);
+        else
+            sprintf(buffer,"  Offset %4ld bytes: %13.5g iterations/sec",offsets[i],rate);
+        output_string(buffer);
+        if(score>(double)0.0)
+        {   sprintf(buffer,"  %6.1f %%",(double)100.0*rate/score);
+            output_string(buffer);
+        }
+        output_string("\n");
+    }
+    return;
+}
+
+/****************
+** show_warmup **
+*****************
+** Display the warmup runs of the last test next to score, the
+** mean of the scored runs: how long they took and how far the
+** first one was from steady state.
+*/
+static void show_warmup(double score)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+
+    if(warmup.runs==0) return;
+    sprintf(buffer,"  Warmup: %lu runs, %.3g s; first %.5g, last %.5g, min %.5g, max %.5g iterations/sec\n",
+            warmup.runs,warmup.secs,warmup.first,warmup.last,
+            warmup.min,warmup.max);
+    output_string(buffer);
+    if(score>(double)0.0)
+    {   sprintf(buffer,"  Warmup: first run at %.1f %% of score\n",
+                (double)100.0*warmup.first/score);
+        output_string(buffer);
+    }
+    return;
+}
+
+/**************
+** show_cold **
+***************
+** Time test fid again with the caches evicted before every
+** timed iteration and display the cold rate next to warm, the
+** mean of the scored runs.  Every eviction reads through twice
+** the last-level cache, so each cold sample is a single pass
+** and COLDSAMPLES of them are averaged.  The eviction flushes
+** every thread's blocks, so with more than one thread the cold
+** runs use a single one, lest threads flush each other's data
+** while it is timed, and are compared with warm per thread.
+*/
+static void show_cold(int fid, double warm)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    double cold;
+    int saveconc;
+
+    saveconc=global_concurrency;
+    global_concurrency=1;
+    global_cold_on=1;
+    cold=rerun_score(fid,(ulong)0,COLDSAMPLES);
+    global_cold_on=0;
+    global_concurrency=saveconc;
+
+    if(saveconc>1)
+    {   warm/=(double)saveconc;
+        sprintf(buffer,"  Cold cache, one thread: %.5g iterations/sec (warm %.5g per thread",
+                cold,warm);
+    }
+    else
+        sprintf(buffer,"  Cold cache: %.5g iterations/sec (warm %.5g",cold,warm);
+    output_string(buffer);
+    if(warm>(double)0.0)
+    {   sprintf(buffer,", %.1f %%",(double)100.0*cold/warm);
+        output_string(buffer);
+    }
+    output_string(")\n");
+    return;
+}
+
+/***************
+** show_fresh **
+****************
+** Time test fid again with new input data for every iteration
+** and display how much of score, the mean of the scored runs
+** on repeated data, the repetition is worth: branch predictors
+** and prefetchers learn input that is the same every time.
+** Only tests that rebuild their data every iteration (numeric
+** and string sort, bitfield, assignment) are affected much;
+** the others get new data once per run.
+*/
+static void show_fresh(int fid, double score)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    double fresh;
+
+    global_freshdata=1;
+    fresh=rerun_score(fid,(ulong)global_min_seconds,FRESHSAMPLES);
+    global_freshdata=0;
+
+    sprintf(buffer,"  Fresh data: %.5g iterations/sec (repeated %.5g",fresh,score);
+    output_string(buffer);
+    if(score>(double)0.0)
+    {   sprintf(buffer,", learned repetition %.1f %% of score",
+                (double)100.0*(score-fresh)/score);
+        output_string(buffer);
+    }
+    output_string(")\n");
+    return;
+}
+
+/****************
+** show_stream **
+*****************
+** Display the bandwidth of each STREAM kernel in the last
+** run, whose mean rate is score.  With more than one thread,
+** time the test once more on a single thread for comparison.
+*/
+static void show_stream(double score)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    int saveconc;
+
+    sprintf(buffer,"  Bandwidth: %.3f GB/s; copy %.3f, scale %.3f, add %.3f, triad %.3f\n",
+            score*(double)80.0*(double)global_streamstruct.arraysize*1e-9,
+            global_streamgbs[STREAM_COPY],global_streamgbs[STREAM_SCALE],
+            global_streamgbs[STREAM_ADD],global_streamgbs[STREAM_TRIAD]);
+    output_string(buffer);
+    if(global_concurrency>1)
+    {
+        saveconc=global_concurrency;
+        global_concurrency=1;
+        score=rerun_score(TF_STREAM,global_streamstruct.request_secs,1);
+        global_concurrency=saveconc;
+        sprintf(buffer,"  One thread: %.3f GB/s; copy %.3f, scale %.3f, add %.3f, triad %.3f\n",
+                score*(double)80.0*(double)global_streamstruct.arraysize*1e-9,
+                global_streamgbs[STREAM_COPY],global_streamgbs[STREAM_SCALE],
+                global_streamgbs[STREAM_ADD],global_streamgbs[STREAM_TRIAD]);
+        output_string(buffer);
+    }
+    return;
+}
+
+/*********************
+** size_from_caches **
+**********************
+** Give the memory tests whose size the command line left
+** open sizes relative to the last level cache of this host:
+** the STREAM arrays of all threads together at four times the
+** LLCs they can spread over (one per thread, up to the number
+** of LLCs), the latency and prefetch buffers, which each
+** thread walks alone, at four times one LLC, and the latency
+** sweep out to twice the scored chain.  The
+** compiled-in sizes are the floor, and are used as they are
+** where sysfs does not give the cache sizes.
+*/
+static void size_from_caches(void)
+{
+    ulong llc;
+    ulong nbytes;
+    int llcs;
+
+    llc=(ulong)LLCSize();
+    llcs=LLCDomains();
+    if(llcs>global_concurrency)
+        llcs=global_concurrency;
+
+    if(global_streamstruct.arraysize==0)
+    {   global_streamstruct.arraysize=4UL*(ulong)llcs*llc/
+            (ulong)sizeof(double)/(ulong)global_concurrency;
+        if(global_streamstruct.arraysize<STREAMARRAYSIZE)
+            global_streamstruct.arraysize=STREAMARRAYSIZE;
+    }
+
+    if(global_latencystruct.arraysize==0)
+    {   for(nbytes=LATENCYARRAYSIZE;nbytes<4UL*llc;nbytes*=2)
+            ;
+        global_latencystruct.arraysize=nbytes;
+    }
+    if(global_latencymax==0)
+    {   global_latencymax=2UL*global_latencystruct.arraysize;
+        if(global_latencymax<LATENCYMAXSIZE)
+            global_latencymax=LATENCYMAXSIZE;
+    }
+
+    if(global_prefetchsize==0)
+    {   global_prefetchsize=4UL*llc;
+        if(global_prefetchsize<PREFETCHARRAYSIZE)
+            global_prefetchsize=PREFETCHARRAYSIZE;
+    }
+    return;
+}
+
+/*****************
+** show_latency **
+******************
+** Display the latency of the scored chain, whose mean rate
+** over all threads is score, then sweep chains from
+** LATENCYMINSIZE to global_latencymax on one thread, on normal
+** pages and on huge pages (those of HUGEPAGES, or transparent
+** huge pages if it is off).  Where the two columns part is
+** the cost of data TLB misses.
+*/
+static void show_latency(double score)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    char size[24];          /* Chain size */
+    char huge[16];          /* Huge page column */
+    int savehuge, hp, level;
+    ulong nbytes, fallbacks;
+    double ns, hns;
+
+    sprintf(buffer,"  Latency: %.2f ns per load over %lu MB\n",
+            (double)global_concurrency*1e9/score,
+            global_latencystruct.arraysize>>20);
+    output_string(buffer);
+
+    savehuge=global_hugepages;
+    hp=savehuge!=HUGE_OFF ? savehuge : HUGE_THP;
+    output_string(hp==HUGE_THP ? "  Size           : 4K pages    : THP-advised\n" :
+            "  Size           : 4K pages    : Huge pages\n");
+    for(nbytes=LATENCYMINSIZE;nbytes<=global_latencymax;nbytes*=2)
+    {
+        if(nbytes>=(1UL<<30))
+            sprintf(size,"%lu GB",nbytes>>30);
+        else if(nbytes>=(1UL<<20))
+            sprintf(size,"%lu MB",nbytes>>20);
+        else
+            sprintf(size,"%lu KB",nbytes>>10);
+        for(level=1;level<=3;level++)
+            if(nbytes<=CacheSize(level))
+            {   sprintf(size+strlen(size)," (L%d)",level);
+                break;
+            }
+
+        global_hugepages=HUGE_OFF;
+        ns=LatencyNs(nbytes,LATENCYSWEEPSECS);
+        if(ns<(double)0.0)
+            break;
+        strcpy(huge,"-");
+        if(nbytes>=HUGE_MINBYTES)
+        {   global_hugepages=hp;
+            fallbacks=mem_huge_fallbacks;
+            hns=LatencyNs(nbytes,LATENCYSWEEPSECS);
+            if(hns>=(double)0.0 && mem_huge_fallbacks==fallbacks)
+                sprintf(huge,"%.2f ns",hns);
+            else
+                strcpy(huge,"n/a");
+        }
+        sprintf(buffer,"  %-13s  : %8.2f ns : %s\n",size,ns,huge);
+        output_string(buffer);
+    }
+    global_hugepages=savehuge;
+    return;
+}
+
+/******************
+** show_prefetch **
+*******************
+** Time walks of the prefetch sweep array, forward and
+** backward: one stream at every power of two stride up to
+** global_prefetchstride (and at 101, the row length of the LU
+** and assignment matrices), then several streams side by side.
+** Each pattern gets ns per load and the bandwidth of the lines
+** it pulls in.
+*/
+static void show_prefetch(void)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    char pattern[32];
+    ulong stride;
+    int streams;
+
+    sprintf(buffer,"** Prefetch sweep over %lu MB, strides in 8-byte elements:\n",
+            global_prefetchsize>>20);
+    output_string(buffer);
+    output_string("  Pattern              : Forward             : Backward\n");
+    for(stride=1;stride<=global_prefetchstride;stride*=2)
+    {   sprintf(pattern,"stride %lu",stride);
+        show_prefetch_row(pattern,stride,1);
+        if(stride==64 && global_prefetchstride>=101)
+            show_prefetch_row("stride 101 LU/ASSIGN",101,1);
+    }
+    for(streams=2;streams<=32;streams*=2)
+    {   sprintf(pattern,"%d streams, stride 1",streams);
+        show_prefetch_row(pattern,1,streams);
+    }
+    output_string("  NUMERIC SORT's heap sift doubles its stride at every level.\n");
+    return;
+}
+
+/**********************
+** show_prefetch_row **
+***********************
+** Time one pattern both ways and display it.  A load moves
+** 8 bytes at unit stride; past 8 elements every load is a
+** line of its own.
+*/
+static void show_prefetch_row(char *pattern, ulong stride, int streams)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    double fwd, back, bytes;
+
+    bytes=stride<8 ? (double)(8*stride) : (double)64.0;
+    fwd=PrefetchNs(stride,0,streams,PREFETCHSECS);
+    back=PrefetchNs(stride,1,streams,PREFETCHSECS);
+    sprintf(buffer,"  %-20.20s : %6.2f ns %6.2f GB/s : %6.2f ns %6.2f GB/s\n",
+            pattern,fwd,bytes/fwd,back,bytes/back);
+    output_string(buffer);
+    return;
+}
+
+/*****************
+** show_memmove **
+******************
+** Display the bandwidth of the scored moves, whose mean rate
+** over all threads is score, then time every implementation
+** that runs on this CPU on one thread, over sizes from
+** MOVESWEEPMIN up to twice the last level cache (at least
+** MOVESWEEPMAX): apart and aligned, apart with the destination
+** 3 bytes off, and overlapping by 64 bytes both ways.
+*/
+static void show_memmove(double score)
+{
+    static char *cases[] = { "apart", "apart+3", "dst<src", "dst>src" };
+    char buffer[BUF_SIZ];   /* Display buffer */
+    char *buf, *src, *dst;
+    ulong nbytes, maxbytes;
+    int systemerror;
+    int c, k;
+
+    sprintf(buffer,"  Throughput: %.3f GB/s, %s\n",
+            score*(double)global_memmovestruct.arraysize*1e-9,
+            movenames[global_movemem]);
+    output_string(buffer);
+
+    for(maxbytes=MOVESWEEPMAX;maxbytes<2UL*(ulong)LLCSize();maxbytes*=2)
+        ;
+    buf=(char *)AllocateMemory(2UL*maxbytes+OFFSET_PAGE,&systemerror);
+    if(systemerror)
+    {   output_string("  Sweep: not enough memory\n");
+        return;
+    }
+    memset(buf,1,(size_t)(2UL*maxbytes+OFFSET_PAGE));
+
+    output_string("  Size      Case    :");
+    for(k=0;k<MOVE_AUTO;k++)
+        if(MoveAvailable(k))
+        {   sprintf(buffer," %7s",movenames[k]);
+            output_string(buffer);
+        }
+    output_string("  (GB/s)\n");
+    for(nbytes=MOVESWEEPMIN;nbytes<=maxbytes;nbytes*=4)
+        for(c=0;c<4;c++)
+        {
+            if(c<2)
+            {   src=buf;
+                dst=buf+maxbytes+OFFSET_PAGE/2+(c==1 ? 3 : 0);
+            }
+            else
+            {   src=buf+(c==2 ? 64 : 0);
+                dst=buf+(c==2 ? 0 : 64);
+            }
+            if(nbytes>=(1UL<<20))
+                sprintf(buffer,"  %4lu MB  %-7s :",nbytes>>20,cases[c]);
+            else if(nbytes>=(1UL<<10))
+                sprintf(buffer,"  %4lu KB  %-7s :",nbytes>>10,cases[c]);
+            else
+                sprintf(buffer,"  %4lu B   %-7s :",nbytes,cases[c]);
+            output_string(buffer);
+            for(k=0;k<MOVE_AUTO;k++)
+                if(MoveAvailable(k))
+                {   sprintf(buffer," %7.2f",MoveGBs(k,dst,src,nbytes,MOVESWEEPSECS));
+                    output_string(buffer);
+                }
+            output_string("\n");
+        }
+    FreeMemory((farvoid *)buf,&systemerror);
+    return;
+}
+
+/***************
+** show_churn **
+****************
+** Display the allocator churn rate, score operations/sec. over
+** all threads, and how the resident set grew around the run.
+** Then time the same mix on one thread with a few live blocks,
+** through malloc() and through AllocateMemory().
+*/
+static void show_churn(double score)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    double before, rate;
+
+    sprintf(buffer,"  Throughput: %.3f Mops/s (%d thread%s), %.3f Mops/s per thread\n",
+            score*1e-6,global_concurrency,global_concurrency>1 ? "s" : "",
+            score*1e-6/(double)global_concurrency);
+    output_string(buffer);
+    before=global_churnrss[CHURN_RSSBEFORE];
+    sprintf(buffer,"  RSS: %.1f MB before, %.1f MB at peak, %.1f MB after freeing (%+.1f MB kept)\n",
+            before/1048576.0,global_churnrss[CHURN_RSSPEAK]/1048576.0,
+            global_churnrss[CHURN_RSSAFTER]/1048576.0,
+            (global_churnrss[CHURN_RSSAFTER]-before)/1048576.0);
+    output_string(buffer);
+
+    sprintf(buffer,"  One thread, %lu live blocks: malloc %.3f Mops/s",
+            CHURNCOMPARELIVE,
+            ChurnRate(CHURN_MALLOC,CHURNCOMPARELIVE,CHURNCOMPARESECS)*1e-6);
+    output_string(buffer);
+    rate=ChurnRate(CHURN_ALLOCMEM,CHURNCOMPARELIVE,CHURNCOMPARESECS);
+    if(rate<(double)0.0)
+        output_string(", AllocateMemory n/a\n");
+    else
+    {   sprintf(buffer,", AllocateMemory %.3f Mops/s\n",rate*1e-6);
+        output_string(buffer);
+    }
+    return;
+}
+
+/***************
+** show_fault **
+****************
+** Display the page fault cycle rate, score cycles/sec. over
+** all threads, as the time per 4 KB faulted in.  Then time
+** every step of the cycle on 4 KB and on huge pages, on one
+** thread and on all of them at once.
+*/
+static void show_fault(double score)
+{
+    char buffer[BUF_SIZ];   /* Display buffer */
+    double ns[FAULTPHASES];
+    int huge, threads, k;
+
+    if(global_faultsmall)
+        output_string("  Note: the kernel refused huge pages; scored on 4 KB pages\n");
+    sprintf(buffer,"  Cycle: %.0f ns per 4 KB per thread, %.3f GB/s faulted in\n",
+            (double)global_concurrency*1e9*(double)OFFSET_PAGE/
+                (score*(double)global_faultstruct.arraysize),
+            (double)2.0*score*(double)global_faultstruct.arraysize*1e-9);
+    output_string(buffer);
+
+    output_string("  Pages  Threads :    mmap   touch dontneed refault  munmap  (ns per 4 KB)\n");
+    for(huge=0;huge<2;huge++)
+        for(threads=1;threads<=global_concurrency;
+                threads=threads<global_concurrency ? global_concurrency : threads+1)
+        {
+            sprintf(buffer,"  %-5s %8d :",huge ? "huge" : "4 KB",threads);
+            output_string(buffer);
+            if(FaultRun(huge,threads,global_faultstruct.arraysize,
+                    FAULTREPORTSECS,ns)!=0)
+            {   output_string("     n/a\n");
+                continue;
+            }
+            for(k=0;k<FAULTPHASES;k++)
+            {   sprintf(buffer," %7.1f",ns[k]);
+                output_string(buffer);
+            }
+            output_string("\n");
+        }
+    return;
+}
+
+#ifdef OPCOUNT
+/*****************
+** show_opcount **
+******************
+** Run test fid once more with the operation counters on and
+** display how many operations of each kind an iteration does
+** and what each costs, using score (the mean of the scored,
+** uncounted runs).  Cycles are actual core cycles where APERF
+** is counted; otherwise they are nominal TSC cycles, which
+** differ from core cycles under turbo or throttling, and are
+** labeled so.
+*/
+static void show_opcount(int fid, double score)
+{
+    static char *opnames[NUMOPKINDS] = {
+        "compares", "swaps", "bytes moved", "bits", "blocks" };
+    char buffer[BUF_SIZ];   /* Display buffer */
+    TestControlStruct *testctl;
+    double perit, nsop, ghz;
+    char *cycles;           /* Which cycles ghz counts */
+    int i;
+
+    testctl=(TestControlStruct *)global_fstruct[fid];
+    global_opcount_on=1;
+    (*funcpointer[fid])();
+    global_opcount_on=0;
+    if(testctl->result.iterations<=(double)0.0 || score<=(double)0.0)
+        return;
+
+    ghz=(double)0.0;
+    cycles="cycles/op";
+    if(testctl->result.perfcount[PERF_APERF]>(double)0.0 &&
+            testctl->result.cpusecs>(double)0.0)
+        ghz=testctl->result.perfcount[PERF_APERF]/testctl->result.cpusecs*1e-9;
+#ifdef TSC_TIMER
+    else if(global_use_tsc)
+    {   ghz=global_tsc_hz*1e-9;
+        cycles="TSC cycles/op";
+    }
+#endif
+
+    for(i=0;i<NUMOPKINDS;i++)
+    {
+        if(testctl->result.opcount[i]<=(double)0.0) continue;
+        perit=testctl->result.opcount[i]/testctl->result.iterations;
+        /*
+         ** Per thread: score is the rate of all threads together.
+         */
+        nsop=1e9*(double)global_concurrency/(score*perit);
+        sprintf(buffer,"  %-12s: %12.5g per iteration  %9.4g ns/op",
+                opnames[i],perit,nsop);
+        output_string(buffer);
+        if(ghz>(double)0.0)
+        {   sprintf(buffer,"  %9.4g %s",nsop*ghz,cycles);
+            output_string(buffer);
+        }
+        output_string("\n");
+    }
+    return;
+}
+#endif
+
 /*
 ** Following code added for Mac stuff, so that we can emulate command
 ** lines.
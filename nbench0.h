@@ -76,8 +76,46 @@ char *compilerversion="Have a nice day";
 #define PF_LUNARRAYS 39         /* LUNUMARRAYS */
 #define PF_LUMINS 40            /* LUMINSECONDS */
 #define PF_ALIGN 41		        /* ALIGN */
+#define PF_TOPDOWN 42           /* TOPDOWN */
+#define PF_FREQMON 43           /* FREQMON */
+#define PF_NOISEMON 44          /* NOISEMON */
+#define PF_NOISEREJECT 45       /* NOISEREJECT */
+#define PF_PROFILE 46           /* PROFILE */
+#define PF_ROOFLINE 47          /* ROOFLINE */
+#define PF_TRACEFILE 48         /* TRACEFILE */
+#define PF_ENERGY 49            /* ENERGY */
+#define PF_COLD 50              /* COLD */
+#define PF_FRESHDATA 51         /* FRESHDATA */
+#define PF_WARMUP 52            /* WARMUP */
+#define PF_WARMUPRUNS 53        /* WARMUPRUNS */
+#define PF_FOOTPRINT 54         /* FOOTPRINT */
+#define PF_ISOLATE 55           /* ISOLATE */
+#define PF_HUGEPAGES 56         /* HUGEPAGES */
+#define PF_ALIGNSWEEP 57        /* ALIGNSWEEP */
+#define PF_DOSTREAM 58          /* DOSTREAM */
+#define PF_STREAMASIZE 59       /* STREAMARRAYSIZE */
+#define PF_STREAMMINS 60        /* STREAMMINSECONDS */
+#define PF_DOLATENCY 61         /* DOLATENCY */
+#define PF_LATENCYASIZE 62      /* LATENCYARRAYSIZE */
+#define PF_LATENCYMAX 63        /* LATENCYMAXSIZE */
+#define PF_LATENCYMINS 64       /* LATENCYMINSECONDS */
+#define PF_PREFETCH 65          /* PREFETCHSWEEP */
+#define PF_PREFETCHASIZE 66     /* PREFETCHARRAYSIZE */
+#define PF_PREFETCHSTRIDE 67    /* PREFETCHSTRIDE */
+#define PF_MEMMOVE 68           /* MEMMOVE */
+#define PF_DOMEMMOVE 69         /* DOMEMMOVE */
+#define PF_MEMMOVESIZE 70       /* MEMMOVESIZE */
+#define PF_MEMMOVEMINS 71       /* MEMMOVEMINSECONDS */
+#define PF_DOCHURN 72           /* DOCHURN */
+#define PF_CHURNLIVE 73         /* CHURNLIVE */
+#define PF_CHURNMINS 74         /* CHURNMINSECONDS */
+#define PF_DOFAULT 75           /* DOFAULT */
+#define PF_FAULTSIZE 76         /* FAULTSIZE */
+#define PF_FAULTMINS 77         /* FAULTMINSECONDS */
+#define PF_RANDGEN 78           /* RANDGEN */
+#define PF_INITTHREADS 79       /* INITTHREADS */
 
-#define MAXPARAM 41
+#define MAXPARAM 79
 
 /* Tests-to-do flags...must coincide with test. */
 #define TF_NUMSORT 0
@@ -90,8 +128,19 @@ char *compilerversion="Have a nice day";
 #define TF_HUFF 7
 #define TF_NNET 8
 #define TF_LU 9
+#define TF_STREAM 10
+#define TF_LATENCY 11
+#define TF_MEMMOVE 12
+#define TF_CHURN 13
+#define TF_FAULT 14
 
-#define NUMTESTS 10
+#define NUMTESTS 15
+
+/*
+** Tests below this id make up the indexes and run by default;
+** the rest have no baseline and run only when asked for.
+*/
+#define NUMINDEXTESTS 10
 
 /*
 ** GLOBALS
@@ -99,6 +148,84 @@ char *compilerversion="Have a nice day";
 
 #define BUF_SIZ 1024
 
+/*
+** Record of one scored run (sample) of a test.
+*/
+typedef struct {
+        double score;           /* Iterations/sec. */
+        double ghz;             /* Effective clock in GHz, 0 if unknown */
+        double temp;            /* Hottest thermal zone in deg C */
+        int throttled;          /* CPU was throttled during the run */
+        NoiseSampleStruct noise;        /* Outside activity during the run */
+        double iterations;      /* Iterations done */
+        EnergyStruct energy;    /* Joules used by the run */
+} SampleStruct;
+
+/*
+** Record of the warmup runs of a test.
+*/
+typedef struct {
+        ulong runs;             /* Warmup runs done */
+        double secs;            /* Seconds timed in them */
+        double first;           /* Score of the first run */
+        double last;            /* Score of the last run */
+        double min;             /* Lowest score */
+        double max;             /* Highest score */
+} WarmupStruct;
+
+/*
+** Upper limit on warmup runs of a test.
+*/
+#define MAXWARMUP 100000
+
+/*
+** At most this many disturbed runs of a test are thrown away
+** when NOISEREJECT is set.
+*/
+#define MAXREJECTS 30
+
+/*
+** Samples taken of every test in cold-cache mode.
+*/
+#define COLDSAMPLES 10
+
+/*
+** Samples taken of every test with FRESHDATA.
+*/
+#define FRESHSAMPLES 3
+
+/*
+** Seconds each chain of the latency sweep is followed.
+*/
+#define LATENCYSWEEPSECS 0.05
+
+/*
+** Seconds each pattern of the prefetch sweep is walked.
+*/
+#define PREFETCHSECS 0.1
+
+/*
+** Seconds each size, case and implementation of the memmove
+** sweep is timed, and the smallest and largest sizes swept.
+*/
+#define MOVESWEEPSECS 0.02
+#define MOVESWEEPMIN 64UL
+#define MOVESWEEPMAX (64UL<<20)
+
+/*
+** Seconds the churn report times each allocator, and the
+** blocks kept live meanwhile: few enough for AllocateMemory()'s
+** memory array.
+*/
+#define CHURNCOMPARESECS 0.2
+#define CHURNCOMPARELIVE 8UL
+
+/*
+** Seconds the page fault report times each page size and
+** thread count.
+*/
+#define FAULTREPORTSECS 0.2
+
 /*
 ** Test names
 */
@@ -112,7 +239,12 @@ char *ftestnames[] = {
         "IDEA            ",
         "HUFFMAN         ",
         "NEURAL NET      ",
-        "LU DECOMPOSITION" };
+        "LU DECOMPOSITION",
+        "STREAM          ",
+        "MEMORY LATENCY  ",
+        "MEMMOVE         ",
+        "MALLOC CHURN    ",
+        "PAGE FAULT      " };
 
 /*
 ** Indexes -- Baseline is DELL Pentium XP90
@@ -190,7 +322,45 @@ char *paramnames[]= {
         "DOLU",
         "LUNUMARRAYS",
         "LUMINSECONDS",
-	"ALIGN" };
+	"ALIGN",
+        "TOPDOWN",
+        "FREQMON",
+        "NOISEMON",
+        "NOISEREJECT",
+        "PROFILE",
+        "ROOFLINE",
+        "TRACEFILE",
+        "ENERGY",
+        "COLD",
+        "FRESHDATA",
+        "WARMUP",
+        "WARMUPRUNS",
+        "FOOTPRINT",
+        "ISOLATE",
+        "HUGEPAGES",
+        "ALIGNSWEEP",
+        "DOSTREAM",
+        "STREAMARRAYSIZE",
+        "STREAMMINSECONDS",
+        "DOLATENCY",
+        "LATENCYARRAYSIZE",
+        "LATENCYMAXSIZE",
+        "LATENCYMINSECONDS",
+        "PREFETCHSWEEP",
+        "PREFETCHARRAYSIZE",
+        "PREFETCHSTRIDE",
+        "MEMMOVE",
+        "DOMEMMOVE",
+        "MEMMOVESIZE",
+        "MEMMOVEMINSECONDS",
+        "DOCHURN",
+        "CHURNLIVE",
+        "CHURNMINSECONDS",
+        "DOFAULT",
+        "FAULTSIZE",
+        "FAULTMINSECONDS",
+        "RANDGEN",
+        "INITTHREADS" };
 
 /*
 ** Following globals added to support command line emulation on
@@ -233,9 +403,13 @@ extern FARPROC lpfn;
 ** PROTOTYPES
 */
 static int parse_arg(char *argptr);
+static int parse_long_arg(char *argptr);
 static void display_help(char *progname);
 static void read_comfile(FILE *cfile);
 static int getflag(char *cptr);
+static int gethuge(char *cptr);
+static int getmove(char *cptr);
+static int getrandgen(char *cptr);
 static void strtoupper(char *s);
 static void set_request_secs(void);
 static int bench_with_confidence(int fid,
@@ -249,9 +423,38 @@ static int calc_confidence(double scores[],
         int num_scores,
         double *c_half_interval,double *smean,
         double *sdev);
+static double run_sample(int fid, SampleStruct *sample);
 static double getscore(int fid);
 static void output_string(char *buffer);
 static void show_stats(int bid);
+static void show_topdown(int bid);
+static void show_freq(ulong numtries);
+static void show_noise(ulong numtries, int uncertain);
+static void show_profile(void);
+static int roofline_work(int fid, double *bytes, double *ops, int *isflop);
+static void show_roofline(int fid, double score);
+static void show_energy(ulong numtries);
+static double run_test(int i);
+static double isolated_test(int i);
+static void warm_up(int fid);
+static void show_warmup(double score);
+static void show_footprint(FootprintStruct *fp);
+static void show_hugepages(int fid, double score);
+static void show_alignsweep(int fid, double score);
+static double rerun_score(int fid, ulong secs, int numruns);
+static void show_cold(int fid, double warm);
+static void show_fresh(int fid, double score);
+static void show_stream(double score);
+static void size_from_caches(void);
+static void show_latency(double score);
+static void show_prefetch(void);
+static void show_prefetch_row(char *pattern, ulong stride, int streams);
+static void show_memmove(double score);
+static void show_churn(double score);
+static void show_fault(double score);
+#ifdef OPCOUNT
+static void show_opcount(int fid, double score);
+#endif
 
 #ifdef MAC
 void UCommandLine(void);
@@ -272,5 +475,14 @@ extern void DoIDEA(void);
 extern void DoHuffman(void);
 extern void DoNNET(void);
 extern void DoLU(void);
+extern void DoStream(void);
+extern void DoLatency(void);
+extern double LatencyNs(ulong nbytes, double secs);
+extern void DoMemMove(void);
+extern void DoChurn(void);
+extern double ChurnRate(int kind, ulong live, double secs);
+extern void DoFault(void);
+extern int FaultRun(int huge, int threads, ulong nbytes, double secs,
+        double *ns);
 
 extern void ErrorExit(void);    /* From SYSSPEC */
@@ -92,3 +92,33 @@ void DoNNET(void);
 ***********************/
 
 void DoLU(void);
+
+/************
+** STREAM  **
+************/
+
+void DoStream(void);
+
+/********************
+** MEMORY LATENCY  **
+********************/
+
+void DoLatency(void);
+
+/*************
+** MEMMOVE  **
+*************/
+
+void DoMemMove(void);
+
+/******************
+** MALLOC CHURN  **
+******************/
+
+void DoChurn(void);
+
+/****************
+** PAGE FAULT  **
+****************/
+
+void DoFault(void);
@@ -207,6 +207,37 @@
 */
 #define MEM_ARRAY_SIZE 20
 
+/*
+** Maximum number of hardware performance counters
+** read per benchmark thread.  See perfmon.h.
+*/
+#define MAXPERFCOUNTERS 16
+
+/*
+** Operation counters.  Built with -DOPCOUNT, the hot paths of the
+** integer tests count the operations they perform, and nbench
+** reports the time and cycles each one costs.  Counting is only
+** switched on for one extra run after the scored runs, and only
+** between StartStopWatch() and StopStopWatch(); without OPCOUNT
+** the counters compile to nothing.
+*/
+#define OP_COMPARE 0            /* Comparisons (sorts) */
+#define OP_SWAP 1               /* Exchanges (sorts) */
+#define OP_BYTES 2              /* Bytes moved by MoveMemory */
+#define OP_BITS 3               /* Bits set, cleared, flipped or decoded */
+#define OP_BLOCKS 4             /* 64-bit cipher blocks */
+#define NUMOPKINDS 5
+
+#ifdef OPCOUNT
+extern int global_opcount_on;
+extern __thread int opcount_timed;
+extern __thread unsigned long opcount[NUMOPKINDS];
+#define OPCOUNT_ADD(kind,n) \
+    do { if(opcount_timed) opcount[kind]+=(unsigned long)(n); } while(0)
+#else
+#define OPCOUNT_ADD(kind,n)
+#endif
+
 /*
 ** TYPEDEFS
 */
@@ -267,6 +298,10 @@ typedef struct {
     double iterations;     /* # of iterations */
     double cpusecs;        /* CPU time used in seconds */
     double realsecs;       /* Real time used in seconds */
+    double perfcount[MAXPERFCOUNTERS]; /* Hardware counter totals */
+#ifdef OPCOUNT
+    double opcount[NUMOPKINDS];     /* Operation counts */
+#endif
 } TestResultStruct;
 
 typedef struct {
@@ -280,12 +315,14 @@ typedef struct {
     ulong bitfieldarraysize;        /* Bit field array size */
     double cpurate;         /* iteration or operations per second in cpu time */
     double realrate;        /* iteration or operations per second in real time */
+    double perfcount[MAXPERFCOUNTERS]; /* Counter totals over all scored runs */
     char *errorcontext;     /* Error context string pointer */
 } TestControlStruct;
 
 typedef struct {
     TestControlStruct *control; /* point to test control */
     TestResultStruct result;    /* test result to return */
+    void *(*thread_func)(void *); /* benchmark body run by this thread */
 } TestThreadData;
 
 /*****************
@@ -554,6 +591,135 @@ typedef struct {
         double iterspersec;     /* Results */
 } LUStruct;
 
+/************
+** STREAM  **
+*************/
+
+/*
+** STREAMARRAYSIZE
+**
+** Smallest default number of doubles in each of the three
+** STREAM arrays (64 MB each).  The arrays should be several
+** times the size of the last level cache or the test measures
+** the cache, so where sysfs gives its size the default is
+** four times the LLC.
+*/
+#define STREAMARRAYSIZE 8388608L
+
+/*
+** Kernels, in the order they run.
+*/
+#define STREAM_COPY 0
+#define STREAM_SCALE 1
+#define STREAM_ADD 2
+#define STREAM_TRIAD 3
+#define STREAMKERNELS 4
+
+extern double global_streamgbs[STREAMKERNELS]; /* GB/s of the last run */
+
+/********************
+** MEMORY LATENCY  **
+*********************/
+
+/*
+** LATENCYARRAYSIZE
+**
+** Smallest default size in bytes of the chain the scored test
+** follows.  Like the STREAM arrays it must be well beyond the
+** last level cache; the default is the first power of two
+** from here up that is four times the LLC.
+*/
+#define LATENCYARRAYSIZE (256UL<<20)
+
+/*
+** The report sweeps chains from LATENCYMINSIZE up to twice
+** the scored chain, but at least LATENCYMAXSIZE (or to
+** LATENCYMAXSIZE= from the command file), doubling the size
+** each step.
+*/
+#define LATENCYMINSIZE (16UL<<10)
+#define LATENCYMAXSIZE (1UL<<30)
+
+/*
+** LATENCYLINE is the distance between links, one cache line.
+** LATENCYCHUNK is the number of loads per timed region; it must
+** be a multiple of 32.
+*/
+#define LATENCYLINE 64
+#define LATENCYCHUNK (1UL<<18)
+
+extern ulong global_latencymax;        /* Largest size swept, bytes */
+
+/*************
+** MEMMOVE  **
+**************/
+
+/*
+** MEMMOVESIZE is the default number of bytes the memmove test
+** shifts back and forth, MEMMOVESHIFT bytes at a time: about
+** the tail the string sort shifts on an exchange.
+*/
+#define MEMMOVESIZE 8111UL
+#define MEMMOVESHIFT 13UL
+
+/******************
+** MALLOC CHURN  **
+*******************/
+
+/*
+** CHURNLIVE is the default number of blocks each thread keeps
+** live.  CHURNOPS is the number of blocks replaced per timed
+** region.
+*/
+#define CHURNLIVE 4096UL
+#define CHURNOPS 65536UL
+
+/*
+** One in CHURNCROSS (a power of two) of the blocks a thread
+** replaces is freed by the next thread.  CHURNMAIL is the
+** most blocks that may wait for it.
+*/
+#define CHURNCROSS 4
+#define CHURNMAIL 1024
+
+/*
+** Allocators ChurnRate() can use.
+*/
+#define CHURN_MALLOC 0
+#define CHURN_ALLOCMEM 1
+
+/*
+** Resident set size readings of global_churnrss[].
+*/
+#define CHURN_RSSBEFORE 0
+#define CHURN_RSSPEAK 1
+#define CHURN_RSSAFTER 2
+#define CHURNRSSKINDS 3
+
+extern double global_churnrss[CHURNRSSKINDS]; /* RSS around the runs */
+
+/****************
+** PAGE FAULT  **
+*****************/
+
+/*
+** FAULTSIZE is the default size in bytes of the region each
+** thread maps, faults in and unmaps per cycle.
+*/
+#define FAULTSIZE (64UL<<20)
+
+/*
+** Steps of a cycle, each timed on its own.
+*/
+#define FAULT_MMAP 0
+#define FAULT_TOUCH 1
+#define FAULT_DONTNEED 2
+#define FAULT_REFAULT 3
+#define FAULT_MUNMAP 4
+#define FAULTPHASES 5
+
+extern int global_faultsmall;   /* Kernel refused huge pages: 4 KB used */
+
 /*
 ** EXTERNALS
 */
@@ -570,4 +736,9 @@ extern TestControlStruct global_ideastruct;
 extern TestControlStruct global_huffstruct;
 extern TestControlStruct global_nnetstruct;
 extern TestControlStruct global_lustruct;
+extern TestControlStruct global_streamstruct;
+extern TestControlStruct global_latencystruct;
+extern TestControlStruct global_memmovestruct;
+extern TestControlStruct global_churnstruct;
+extern TestControlStruct global_faultstruct;
 
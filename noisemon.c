@@ -0,0 +1,223 @@
+
+/*
+** noisemon.c
+** Outside activity around benchmark samples.
+**
+** A sample that is slow because the host is slow looks just like
+** one that is slow because something else ran on the host.  These
+** routines take getrusage() and /proc/interrupts readings at the
+** start and end of every sample and count the CPU changes the
+** benchmark threads see at their stopwatch calls, so that samples
+** preempted, migrated or stalled on disk I/O can be told apart.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "noisemon.h"
+
+#ifdef LINUX
+#include <sched.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+/*
+** Global parameters.
+*/
+int global_noisemon;            /* Noise attribution requested */
+int global_noisereject;         /* Retake disturbed samples */
+
+#ifdef LINUX
+
+/*
+** A sample counts as disturbed if another task preempted a
+** benchmark thread more often than the scheduler tick alone
+** would explain, if a thread changed CPU, or if a page had to
+** be read from disk.
+*/
+#define NOISE_IVCSW_PER_SEC 10.0
+
+static volatile long noise_migrations;  /* CPU changes, all threads */
+static volatile long noise_sample;      /* Samples begun */
+static __thread int noise_lastcpu=-1;   /* CPU of the last check */
+static __thread long noise_lastsample;  /* noise_sample at that check */
+
+/*
+** PROTOTYPES
+*/
+static long interrupt_count(void);
+static double wall_secs(void);
+
+/********************
+** interrupt_count **
+*********************
+** Total of all interrupt counters in /proc/interrupts, summed
+** over all CPUs.  Returns -1 if the file can't be read.
+*/
+static long interrupt_count(void)
+{
+    char line[4096];
+    char *p, *end;
+    long total, n;
+    FILE *fp;
+
+    fp=fopen("/proc/interrupts","r");
+    if(fp==(FILE *)NULL) return(-1L);
+    total=0;
+    while(fgets(line,sizeof(line),fp)!=(char *)NULL)
+    {
+        p=strchr(line,':');
+        if(p==(char *)NULL) continue;   /* CPU header line */
+        p++;
+        for(;;)
+        {
+            n=strtol(p,&end,10);
+            if(end==p) break;       /* Reached the description */
+            total+=n;
+            p=end;
+        }
+    }
+    fclose(fp);
+    return(total);
+}
+
+/**************
+** wall_secs **
+***************
+** Monotonic wall clock in seconds.
+*/
+static double wall_secs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return((double)ts.tv_sec+(double)ts.tv_nsec*1e-9);
+}
+
+/**************
+** NoiseInit **
+***************
+** Check that the kernel gives us what we need.
+** Returns 0 if ok, -1 if not; in that case reason holds a
+** short explanation.
+*/
+int NoiseInit(char *reason)
+{
+    struct rusage ru;
+
+    if(getrusage(RUSAGE_SELF,&ru)!=0)
+    {   strcpy(reason,"getrusage() failed");
+        return(-1);
+    }
+    if(sched_getcpu()<0)
+    {   strcpy(reason,"sched_getcpu() not supported");
+        return(-1);
+    }
+    if(interrupt_count()<0)
+    {   strcpy(reason,"/proc/interrupts not readable");
+        return(-1);
+    }
+    return(0);
+}
+
+/******************
+** NoiseCheckCpu **
+*******************
+** Called by the benchmark threads from the stopwatch; counts
+** a migration whenever the calling thread finds itself on
+** another CPU than at its previous check in the same sample.
+** A move between samples (the main thread runs them all) is
+** not the sample's doing.
+*/
+void NoiseCheckCpu(void)
+{
+    int cpu;
+
+    if(!global_noisemon) return;
+    cpu=sched_getcpu();
+    if(noise_lastsample!=noise_sample)
+    {   noise_lastsample=noise_sample;
+        noise_lastcpu=-1;
+    }
+    if(noise_lastcpu>=0 && cpu!=noise_lastcpu)
+        __sync_fetch_and_add(&noise_migrations,1L);
+    noise_lastcpu=cpu;
+}
+
+/*********************
+** NoiseSampleBegin **
+**********************
+** Take the readings that open a sample, and start every
+** thread's CPU afresh.
+*/
+void NoiseSampleBegin(NoiseSampleStruct *ns)
+{
+    struct rusage ru;
+
+    noise_sample++;
+    getrusage(RUSAGE_SELF,&ru);
+    ns->nvcsw=ru.ru_nvcsw;
+    ns->nivcsw=ru.ru_nivcsw;
+    ns->minflt=ru.ru_minflt;
+    ns->majflt=ru.ru_majflt;
+    ns->migrations=noise_migrations;
+    ns->interrupts=interrupt_count();
+    ns->secs=wall_secs();
+    ns->disturbed=0;
+}
+
+/*******************
+** NoiseSampleEnd **
+********************
+** Take the readings that close a sample, turn them into
+** counts over the sample and decide whether it was disturbed.
+** RUSAGE_SELF covers the benchmark threads even after they
+** have been joined.
+*/
+void NoiseSampleEnd(NoiseSampleStruct *ns)
+{
+    struct rusage ru;
+    long irq;
+
+    ns->secs=wall_secs()-ns->secs;
+    getrusage(RUSAGE_SELF,&ru);
+    ns->nvcsw=ru.ru_nvcsw-ns->nvcsw;
+    ns->nivcsw=ru.ru_nivcsw-ns->nivcsw;
+    ns->minflt=ru.ru_minflt-ns->minflt;
+    ns->majflt=ru.ru_majflt-ns->majflt;
+    ns->migrations=noise_migrations-ns->migrations;
+    irq=interrupt_count();
+    ns->interrupts=(irq<0 || ns->interrupts<0) ? 0L : irq-ns->interrupts;
+
+    ns->disturbed=(double)ns->nivcsw>NOISE_IVCSW_PER_SEC*ns->secs+(double)1.0 ||
+        ns->migrations>0 || ns->majflt>0;
+}
+
+#else
+
+/*
+** Elsewhere there is nothing to read.
+*/
+int NoiseInit(char *reason)
+{
+    strcpy(reason,"not supported on this system");
+    return(-1);
+}
+
+void NoiseCheckCpu(void)
+{
+}
+
+void NoiseSampleBegin(NoiseSampleStruct *ns)
+{
+    memset(ns,0,sizeof(NoiseSampleStruct));
+}
+
+void NoiseSampleEnd(NoiseSampleStruct *ns)
+{
+}
+
+#endif
@@ -0,0 +1,34 @@
+/*
+** noisemon.h
+** Header for noisemon.c
+** Tracks outside activity (scheduling, faults, interrupts)
+** around benchmark samples.
+*/
+
+/*
+** TYPEDEFS
+*/
+typedef struct {
+    double secs;            /* Wall time of the sample */
+    long nvcsw;             /* Voluntary context switches */
+    long nivcsw;            /* Involuntary context switches */
+    long minflt;            /* Minor page faults */
+    long majflt;            /* Major page faults */
+    long migrations;        /* CPU changes seen by the benchmark threads */
+    long interrupts;        /* Interrupts taken, all CPUs */
+    int disturbed;          /* Sample was disturbed by outside activity */
+} NoiseSampleStruct;
+
+/*
+** EXTERNALS
+*/
+extern int global_noisemon;     /* Noise attribution requested */
+extern int global_noisereject;  /* Retake disturbed samples */
+
+/*
+** PROTOTYPES
+*/
+int NoiseInit(char *reason);
+void NoiseCheckCpu(void);
+void NoiseSampleBegin(NoiseSampleStruct *ns);
+void NoiseSampleEnd(NoiseSampleStruct *ns);
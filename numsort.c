@@ -64,12 +64,20 @@ void DoNumSortAdjust(TestControlStruct *numsortstruct);
 
 static void *NumSortFunc(void *data);
 static void DoNumSortIteration(farlong *arraybase,
+		farlong *pristine,
 		ulong arraysize,
 		uint numarrays,
         StopWatchStruct *stopwatch);
 static void LoadNumArrayWithRand(farlong *array,
 		ulong arraysize,
 		uint numarrays);
+static void FillNumArray(void *arg,
+		ulong first,
+		ulong last);
+static void RestoreNumArray(farlong *array,
+		farlong *pristine,
+		ulong arraysize,
+		uint numarrays);
 static void NumHeapSort(farlong *array,
 		ulong bottom,
 		ulong top);
@@ -149,6 +157,7 @@ void DoNumSortAdjust(TestControlStruct *numsortstruct)
              */
             ResetStopWatch(&stopwatch);
             DoNumSortIteration(arraybase,
+                        (farlong *)NULL,
                         numsortstruct->arraysize,
                         numsortstruct->numarrays,
                         &stopwatch);
@@ -172,13 +181,18 @@ void *NumSortFunc(void *data)
     TestControlStruct *numsortstruct;      /* Local pointer to global struct */
     StopWatchStruct stopwatch;             /* Stop watch to time the test */
     farlong *arraybase;     /* Base pointers of array */
+    farlong *pristine;      /* Unsorted array to restore from */
     int systemerror;        /* For holding error codes */
 
     testdata = (TestThreadData *)data;
     numsortstruct = testdata->control;
 
+    /*
+     ** One array more than are sorted: it keeps the input,
+     ** generated once, for every iteration to restore.
+     */
     arraybase=(farlong *)AllocateMemory(sizeof(long) *
-               numsortstruct->numarrays * numsortstruct->arraysize,
+               (numsortstruct->numarrays+1) * numsortstruct->arraysize,
                &systemerror);
     if(systemerror)
     {
@@ -187,6 +201,8 @@ void *NumSortFunc(void *data)
                     &systemerror);
         ErrorExit();
     }
+    pristine=arraybase+numsortstruct->numarrays*numsortstruct->arraysize;
+    LoadNumArrayWithRand(pristine,numsortstruct->arraysize,1);
 
     /*
      ** All's well if we get here.  Repeatedly perform sorts until the
@@ -197,6 +213,7 @@ void *NumSortFunc(void *data)
 
     do {
         DoNumSortIteration(arraybase,
+                pristine,
                 numsortstruct->arraysize,
                 numsortstruct->numarrays,
                 &stopwatch);
@@ -220,8 +237,12 @@ void *NumSortFunc(void *data)
 ** This routine executes one iteration of the numeric
 ** sort benchmark.  It returns the number of ticks
 ** elapsed for the iteration.
+** The arrays are copied from pristine, if there is one,
+** rather than generated again; with FRESHDATA every
+** iteration still generates its own.
 */
 static void DoNumSortIteration(farlong *arraybase,
+        farlong *pristine,
         ulong arraysize,
         uint numarrays,
         StopWatchStruct *stopwatch)
@@ -230,7 +251,10 @@ static void DoNumSortIteration(farlong *arraybase,
     /*
      ** Load up the array with random numbers
      */
-    LoadNumArrayWithRand(arraybase,arraysize,numarrays);
+    if(pristine!=(farlong *)NULL && !global_freshdata)
+        RestoreNumArray(arraybase,pristine,arraysize,numarrays);
+    else
+        LoadNumArrayWithRand(arraybase,arraysize,numarrays);
 
     /*
      ** Start the stopwatch
@@ -279,14 +303,17 @@ static void LoadNumArrayWithRand(farlong *array,     /* Pointer to arrays */
      ** Initialize the random number generator
      */
     /* randnum(13L); */
-    randnum((int32)13);
+    randdata();
 
     /*
      ** Load up first array with randoms
      */
-    for(i=0L;i<arraysize;i++)
-        /* array[i]=randnum(0L); */
-        array[i]=randnum((int32)0);
+    if(global_randgen==RAND_SPLITMIX)
+        RandParallel(FillNumArray,(void *)array,arraysize);
+    else
+        for(i=0L;i<arraysize;i++)
+            /* array[i]=randnum(0L); */
+            array[i]=randnum((int32)0);
 
     /*
      ** Now, if there's more than one array to load, copy the
@@ -302,6 +329,45 @@ static void LoadNumArrayWithRand(farlong *array,     /* Pointer to arrays */
     return;
 }
 
+/*****************
+** FillNumArray **
+******************
+** RandParallel() part of LoadNumArrayWithRand(): random longs
+** into elements first to last-1 of the array at arg.
+*/
+static void FillNumArray(void *arg,
+        ulong first,
+        ulong last)
+{
+    farlong *array;         /* Array to fill */
+    ulong i;                /* Used for index */
+
+    array=(farlong *)arg;
+    randseek(first+1L);
+    for(i=first;i<last;i++)
+        array[i]=randnum((int32)0);
+    return;
+}
+
+/********************
+** RestoreNumArray **
+*********************
+** Copy the array LoadNumArrayWithRand() built at pristine
+** into each of the arrays.
+*/
+static void RestoreNumArray(farlong *array,
+        farlong *pristine,
+        ulong arraysize,
+        uint numarrays)
+{
+    while(numarrays--)
+    {   memcpy((void *)array,(void *)pristine,
+                (size_t)arraysize*sizeof(long));
+        array+=arraysize;
+    }
+    return;
+}
+
 /****************
 ** NumHeapSort **
 *****************
@@ -353,10 +419,14 @@ static void NumSift(farlong *array,     /* Array of numbers */
     {
         k=i+i;
         if(k<j)
+        {   OPCOUNT_ADD(OP_COMPARE,1);
             if(array[k]<array[k+1L])
                 ++k;
+        }
+        OPCOUNT_ADD(OP_COMPARE,1);
         if(array[i]<array[k])
         {
+            OPCOUNT_ADD(OP_SWAP,1);
             temp=array[k];
             array[k]=array[i];
             array[i]=temp;
@@ -0,0 +1,654 @@
+
+/*
+** perfmon.c
+** Hardware performance counter support.
+**
+** Counters are opened per benchmark thread and are only enabled
+** between StartStopWatch() and StopStopWatch(), so untimed data
+** setup and the self-adjust probes never show up in the counts.
+** Event encodings are taken from the kernel's sysfs description
+** of the core PMU (/sys/bus/event_source/devices/cpu), which is
+** where the kernel publishes the top-down events on the hosts
+** that support them.  Everywhere else the counters are reported
+** as unavailable and the benchmarks run exactly as before.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "perfmon.h"
+
+#ifdef LINUX
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/*
+** Global parameters.
+*/
+int global_topdown;             /* Top-down breakdown requested */
+
+#ifdef LINUX
+
+#define PERF_SYSFS "/sys/bus/event_source/devices"
+
+/*
+** TYPEDEFS
+*/
+typedef struct {
+    char *name;             /* sysfs event name */
+    int slot;               /* Result slot (PERF_xxx) */
+    int required;           /* Group is useless without it */
+} PerfEventDesc;
+
+typedef struct {
+    struct perf_event_attr attr;    /* Encoded event */
+    double scale;           /* sysfs scale factor */
+    int slot;               /* Result slot (PERF_xxx) */
+    int leader;             /* First event of its group */
+    int useronly;           /* Count user-mode work only */
+} PerfEventStruct;
+
+/*
+** Top-down events.  Icelake and later publish "slots" plus the
+** topdown-* metrics (level 2 on Sapphire Rapids and later);
+** Skylake-era cores publish the older slot/bubble events.
+*/
+static PerfEventDesc topdown_events[] = {
+    { "slots", PERF_SLOTS, 1 },
+    { "topdown-retiring", PERF_RETIRING, 1 },
+    { "topdown-bad-spec", PERF_BADSPEC, 1 },
+    { "topdown-fe-bound", PERF_FEBOUND, 1 },
+    { "topdown-be-bound", PERF_BEBOUND, 1 },
+    { "topdown-heavy-ops", PERF_HEAVYOPS, 0 },
+    { "topdown-br-mispredict", PERF_BRMISPREDICT, 0 },
+    { "topdown-fetch-lat", PERF_FETCHLAT, 0 },
+    { "topdown-mem-bound", PERF_MEMBOUND, 0 },
+    { NULL, 0, 0 } };
+
+static PerfEventDesc old_topdown_events[] = {
+    { "topdown-total-slots", PERF_SLOTS, 1 },
+    { "topdown-slots-issued", PERF_SLOTSISSUED, 1 },
+    { "topdown-slots-retired", PERF_RETIRING, 1 },
+    { "topdown-fetch-bubbles", PERF_FEBOUND, 1 },
+    { "topdown-recovery-bubbles", PERF_RECOVERY, 1 },
+    { NULL, 0, 0 } };
+
+/*
+** Actual and reference cycles, from the "msr" PMU.
+*/
+static PerfEventDesc aperf_events[] = {
+    { "aperf", PERF_APERF, 1 },
+    { "mperf", PERF_MPERF, 1 },
+    { NULL, 0, 0 } };
+
+/*
+** Events resolved by PerfAddxxx(), shared by all threads.
+*/
+static PerfEventStruct perf_events[MAXPERFCOUNTERS];
+static int perf_nevents;
+static int perf_topdown;        /* Top-down events are counted */
+static int perf_old_topdown;    /* Using pre-Icelake top-down events */
+static int perf_aperf;          /* APERF/MPERF are counted */
+static int perf_tlb;            /* Data TLB events are counted */
+
+/*
+** Per-thread state.  perf_nopen is zero on threads that have no
+** counters open, which makes the stopwatch hooks a no-op there.
+*/
+static __thread int perf_fd[MAXPERFCOUNTERS];
+static __thread int perf_nopen;
+
+/*
+** PROTOTYPES
+*/
+static int perf_open(struct perf_event_attr *attr, int group_fd);
+static int read_sysfs(char *path, char *buf, int len);
+static int set_format(char *pmu, char *term, unsigned long long value,
+        struct perf_event_attr *attr);
+static int parse_event(char *pmu, char *name, PerfEventStruct *ev);
+static int add_events(char *pmu, PerfEventDesc *desc, int useronly);
+static int open_events(int *fds);
+static void close_events(int *fds, int n);
+static int try_open(int first, int minimum, char *reason);
+
+/**************
+** perf_open **
+***************
+** Thin wrapper; glibc has no perf_event_open() stub.
+*/
+static int perf_open(struct perf_event_attr *attr, int group_fd)
+{
+    return((int)syscall(__NR_perf_event_open, attr, 0, -1, group_fd, 0));
+}
+
+/***************
+** read_sysfs **
+****************
+** Read the first line of a sysfs file into buf.
+** Returns 0 if ok, -1 if the file can't be read.
+*/
+static int read_sysfs(char *path, char *buf, int len)
+{
+    FILE *fp;
+
+    fp=fopen(path,"r");
+    if(fp==(FILE *)NULL) return(-1);
+    if(fgets(buf,len,fp)==(char *)NULL)
+    {   fclose(fp);
+        return(-1);
+    }
+    fclose(fp);
+    buf[strcspn(buf,"\n")]='\0';
+    return(0);
+}
+
+/***************
+** set_format **
+****************
+** Place value into the perf_event_attr config field described by
+** the PMU's format/<term> file, for example "config:0-7" or
+** "config:0-7,21".
+** Returns 0 if ok, -1 if the term is unknown.
+*/
+static int set_format(char *pmu, char *term, unsigned long long value,
+        struct perf_event_attr *attr)
+{
+    char path[512];
+    char buf[128];
+    char *p;
+    unsigned long long *field;
+    int lo, hi, bit;
+
+    sprintf(path,"%s/%s/format/%s",PERF_SYSFS,pmu,term);
+    if(read_sysfs(path,buf,sizeof(buf))) return(-1);
+
+    if(strncmp(buf,"config1:",8)==0) field=(unsigned long long *)&attr->config1;
+    else if(strncmp(buf,"config2:",8)==0) field=(unsigned long long *)&attr->config2;
+    else if(strncmp(buf,"config:",7)==0) field=(unsigned long long *)&attr->config;
+    else return(-1);
+
+    /*
+     ** Scatter the value over the listed bit ranges, low bits first.
+     */
+    p=strchr(buf,':')+1;
+    while(*p)
+    {
+        lo=hi=(int)strtol(p,&p,10);
+        if(*p=='-') hi=(int)strtol(p+1,&p,10);
+        for(bit=lo;bit<=hi && bit<64;bit++)
+        {   if(value&1ULL) *field|=1ULL<<bit;
+            value>>=1;
+        }
+        if(*p==',') p++;
+        else break;
+    }
+    return(0);
+}
+
+/****************
+** parse_event **
+*****************
+** Build a perf_event_attr from the sysfs description of a
+** named event, e.g. "event=0x00,umask=0x4".
+** Returns 0 if ok, -1 if the event is absent or can't be encoded.
+*/
+static int parse_event(char *pmu, char *name, PerfEventStruct *ev)
+{
+    char path[512];
+    char buf[256];
+    char *term, *eq, *next;
+    unsigned long long value;
+
+    memset(ev,0,sizeof(PerfEventStruct));
+    sprintf(path,"%s/%s/type",PERF_SYSFS,pmu);
+    if(read_sysfs(path,buf,sizeof(buf))) return(-1);
+    ev->attr.type=(unsigned int)atoi(buf);
+    ev->attr.size=sizeof(struct perf_event_attr);
+
+    sprintf(path,"%s/%s/events/%s",PERF_SYSFS,pmu,name);
+    if(read_sysfs(path,buf,sizeof(buf))) return(-1);
+
+    for(term=buf;term!=(char *)NULL && *term;term=next)
+    {
+        next=strchr(term,',');
+        if(next!=(char *)NULL) *next++='\0';
+        value=1;
+        if((eq=strchr(term,'='))!=(char *)NULL)
+        {   *eq++='\0';
+            if(*eq=='?') return(-1);    /* Needs a user parameter */
+            value=strtoull(eq,(char **)NULL,0);
+        }
+        if(set_format(pmu,term,value,&ev->attr)) return(-1);
+    }
+
+    ev->scale=1.0;
+    sprintf(path,"%s/%s/events/%s.scale",PERF_SYSFS,pmu,name);
+    if(read_sysfs(path,buf,sizeof(buf))==0)
+        ev->scale=atof(buf);
+    return(0);
+}
+
+/***************
+** add_events **
+****************
+** Append one counter group to perf_events[].  Optional events
+** that the PMU does not publish are skipped.  The group counts
+** user-mode work only if useronly is set; PMUs that can't tell
+** the modes apart, like "msr", refuse that.
+** Returns 0 if ok, -1 if a required event is missing.
+*/
+static int add_events(char *pmu, PerfEventDesc *desc, int useronly)
+{
+    int first;              /* Index of the group leader */
+
+    first=perf_nevents;
+    for(;desc->name!=(char *)NULL;desc++)
+    {
+        if(perf_nevents>=MAXPERFCOUNTERS ||
+                parse_event(pmu,desc->name,&perf_events[perf_nevents]))
+        {   if(!desc->required) continue;
+            perf_nevents=first;
+            return(-1);
+        }
+        perf_events[perf_nevents].slot=desc->slot;
+        perf_events[perf_nevents].leader=(perf_nevents==first);
+        perf_events[perf_nevents].useronly=useronly;
+        perf_nevents++;
+    }
+    return(0);
+}
+
+/****************
+** open_events **
+*****************
+** Open every resolved event for the calling thread.  Counters
+** start disabled.  Groups added as useronly count user-mode
+** work only, which is all perf_event_paranoid=2 allows anyway.
+** Returns the number of events opened, or -1 on failure.
+*/
+static int open_events(int *fds)
+{
+    int i;
+    int leader_fd=-1;
+
+    for(i=0;i<perf_nevents;i++)
+    {
+        struct perf_event_attr attr;
+
+        attr=perf_events[i].attr;
+        attr.read_format=PERF_FORMAT_GROUP;
+        attr.exclude_kernel=perf_events[i].useronly;
+        attr.exclude_hv=perf_events[i].useronly;
+        attr.disabled=perf_events[i].leader;
+        fds[i]=perf_open(&attr,perf_events[i].leader ? -1 : leader_fd);
+        if(fds[i]<0)
+        {   close_events(fds,i);
+            return(-1);
+        }
+        if(perf_events[i].leader) leader_fd=fds[i];
+    }
+    return(perf_nevents);
+}
+
+/*****************
+** close_events **
+******************
+** Close the first n counters of a thread.
+*/
+static void close_events(int *fds, int n)
+{
+    while(--n>=0)
+        close(fds[n]);
+}
+
+/*************
+** try_open **
+**************
+** Trial-open every resolved event on the calling thread, to
+** make sure this host lets us count the group that starts at
+** perf_events[first].  Trailing optional events of that group
+** are dropped one by one until it opens or only minimum are
+** left.  Returns 0 if ok; on failure the whole group is
+** dropped, -1 is returned and reason says why.
+*/
+static int try_open(int first, int minimum, char *reason)
+{
+    int fds[MAXPERFCOUNTERS];
+
+    while(open_events(fds)<0)
+    {
+        if(perf_nevents-first<=minimum)
+        {   sprintf(reason,"perf_event_open failed (%s)",strerror(errno));
+            perf_nevents=first;
+            return(-1);
+        }
+        perf_nevents--;
+    }
+    close_events(fds,perf_nevents);
+    return(0);
+}
+
+/*******************
+** PerfAddTopdown **
+********************
+** Add the top-down events to the counters every benchmark
+** thread opens.  Call once after the command line has been
+** parsed.  Returns 0 if ok, -1 if unavailable; in that case
+** reason holds a short explanation.
+*/
+int PerfAddTopdown(char *reason)
+{
+    char *pmu;
+    int first;
+
+    /*
+     ** Hybrid parts name the big-core PMU "cpu_core".
+     */
+    pmu="cpu";
+    if(access(PERF_SYSFS "/cpu/events",F_OK)!=0) pmu="cpu_core";
+
+    first=perf_nevents;
+    if(add_events(pmu,topdown_events,1)==0)
+        perf_old_topdown=0;
+    else if(add_events(pmu,old_topdown_events,1)==0)
+        perf_old_topdown=1;
+    else
+    {   strcpy(reason,"kernel exposes no top-down events");
+        return(-1);
+    }
+
+    /*
+     ** Level 2 events are optional: the old events are all
+     ** needed, the new ones need slots plus four metrics.
+     */
+    if(try_open(first,perf_old_topdown ? perf_nevents-first : 5,reason))
+        return(-1);
+    perf_topdown=1;
+    return(0);
+}
+
+/*********************
+** PerfAddFrequency **
+**********************
+** Add the APERF/MPERF counters (published by the kernel's
+** "msr" PMU) to the counters every benchmark thread opens.
+** APERF counts actual core cycles while the thread runs,
+** so APERF over thread CPU time is the effective clock.  The
+** msr PMU rejects the user-mode-only flags, so these count in
+** the kernel too, as the thread CPU time does.
+** Returns 0 if ok, -1 if unavailable.
+*/
+int PerfAddFrequency(char *reason)
+{
+    int first;
+
+    first=perf_nevents;
+    if(add_events("msr",aperf_events,0))
+    {   strcpy(reason,"kernel exposes no APERF/MPERF events");
+        return(-1);
+    }
+    if(try_open(first,2,reason))
+        return(-1);
+    perf_aperf=1;
+    return(0);
+}
+
+/***************
+** PerfAddTlb **
+****************
+** Add data TLB load lookups and misses, the kernel's generic
+** cache events, to the counters every benchmark thread opens.
+** Returns 0 if ok, -1 if unavailable.
+*/
+int PerfAddTlb(char *reason)
+{
+    static int slots[2] = { PERF_DTLBLOADS, PERF_DTLBMISSES };
+    static int results[2] = { PERF_COUNT_HW_CACHE_RESULT_ACCESS,
+            PERF_COUNT_HW_CACHE_RESULT_MISS };
+    int first, i;
+
+    first=perf_nevents;
+    if(perf_nevents+2>MAXPERFCOUNTERS)
+    {   strcpy(reason,"too many counters");
+        return(-1);
+    }
+    for(i=0;i<2;i++)
+    {
+        memset(&perf_events[perf_nevents],0,sizeof(PerfEventStruct));
+        perf_events[perf_nevents].attr.type=PERF_TYPE_HW_CACHE;
+        perf_events[perf_nevents].attr.size=sizeof(struct perf_event_attr);
+        perf_events[perf_nevents].attr.config=PERF_COUNT_HW_CACHE_DTLB|
+                (PERF_COUNT_HW_CACHE_OP_READ<<8)|(results[i]<<16);
+        perf_events[perf_nevents].scale=1.0;
+        perf_events[perf_nevents].slot=slots[i];
+        perf_events[perf_nevents].leader=(i==0);
+        perf_events[perf_nevents].useronly=1;
+        perf_nevents++;
+    }
+    if(try_open(first,2,reason))
+        return(-1);
+    perf_tlb=1;
+    return(0);
+}
+
+/***************
+** PerfHasTlb **
+****************
+** Returns 1 if per-thread data TLB counts are collected.
+*/
+int PerfHasTlb(void)
+{
+    return(perf_tlb);
+}
+
+/******************
+** PerfHasAperf **
+*******************
+** Returns 1 if per-thread APERF/MPERF counts are collected.
+*/
+int PerfHasAperf(void)
+{
+    return(perf_aperf);
+}
+
+/********************
+** PerfThreadStart **
+*********************
+** Open the counters for the calling benchmark thread.
+*/
+void PerfThreadStart(void)
+{
+    perf_nopen=0;
+    if(perf_nevents==0) return;
+    if(open_events(perf_fd)>0)
+        perf_nopen=perf_nevents;
+}
+
+/*******************
+** PerfThreadStop **
+********************
+** Read and close the counters of the calling benchmark thread,
+** storing the totals into counts[] (MAXPERFCOUNTERS entries).
+*/
+void PerfThreadStop(double *counts)
+{
+    unsigned long long buf[MAXPERFCOUNTERS+1];
+    int i, j;
+
+    for(i=0;i<MAXPERFCOUNTERS;i++)
+        counts[i]=(double)0.0;
+    if(perf_nopen==0) return;
+
+    /*
+     ** Each group leader returns { nr, value[nr] } for its group.
+     */
+    for(i=0;i<perf_nopen;i++)
+    {
+        if(!perf_events[i].leader) continue;
+        if(read(perf_fd[i],buf,sizeof(buf))<(ssize_t)sizeof(buf[0]))
+            continue;
+        for(j=0;j<(int)buf[0] && i+j<perf_nopen;j++)
+            counts[perf_events[i+j].slot]+=
+                (double)buf[j+1]*perf_events[i+j].scale;
+    }
+    close_events(perf_fd,perf_nopen);
+    perf_nopen=0;
+}
+
+/********************
+** PerfRegionBegin **
+*********************
+** Enable the calling thread's counters.  Called by
+** StartStopWatch() before it reads the clocks.
+*/
+void PerfRegionBegin(void)
+{
+    int i;
+
+    for(i=0;i<perf_nopen;i++)
+        if(perf_events[i].leader)
+            ioctl(perf_fd[i],PERF_EVENT_IOC_ENABLE,PERF_IOC_FLAG_GROUP);
+}
+
+/******************
+** PerfRegionEnd **
+*******************
+** Disable the calling thread's counters.  Called by
+** StopStopWatch() after it has read the clocks.
+*/
+void PerfRegionEnd(void)
+{
+    int i;
+
+    for(i=0;i<perf_nopen;i++)
+        if(perf_events[i].leader)
+            ioctl(perf_fd[i],PERF_EVENT_IOC_DISABLE,PERF_IOC_FLAG_GROUP);
+}
+
+/****************
+** PerfTopdown **
+*****************
+** Turn accumulated counter totals into a top-down breakdown.
+** Returns 0 if ok, -1 if nothing was counted.
+*/
+int PerfTopdown(double *counts, TopdownStruct *td)
+{
+    double slots;
+    int i;
+
+    td->heavyops=td->brmispredict=td->fetchlat=(double)-1.0;
+    td->membound=td->corebound=(double)-1.0;
+
+    if(!perf_topdown) return(-1);
+
+    if(perf_old_topdown)
+    {
+        /*
+         ** Level 1 only: bad speculation is the issued-but-not-retired
+         ** slots plus recovery bubbles; backend gets the rest.
+         */
+        slots=counts[PERF_SLOTS];
+        if(slots<=(double)0.0) return(-1);
+        td->frontend=counts[PERF_FEBOUND]/slots;
+        td->retiring=counts[PERF_RETIRING]/slots;
+        td->badspec=(counts[PERF_SLOTSISSUED]-counts[PERF_RETIRING]+
+                counts[PERF_RECOVERY])/slots;
+        if(td->badspec<(double)0.0) td->badspec=(double)0.0;
+        td->backend=(double)1.0-td->frontend-td->retiring-td->badspec;
+        if(td->backend<(double)0.0) td->backend=(double)0.0;
+        return(0);
+    }
+
+    /*
+     ** With PERF_METRICS the kernel reports each metric already
+     ** scaled to slots; normalise by their sum so rounding in the
+     ** hardware metrics does not leak into the percentages.
+     */
+    slots=counts[PERF_RETIRING]+counts[PERF_BADSPEC]+
+            counts[PERF_FEBOUND]+counts[PERF_BEBOUND];
+    if(slots<=(double)0.0) return(-1);
+    td->retiring=counts[PERF_RETIRING]/slots;
+    td->badspec=counts[PERF_BADSPEC]/slots;
+    td->frontend=counts[PERF_FEBOUND]/slots;
+    td->backend=counts[PERF_BEBOUND]/slots;
+
+    /*
+     ** Level 2, for whichever events the PMU published.
+     */
+    for(i=0;i<perf_nevents;i++)
+        switch(perf_events[i].slot)
+        {
+            case PERF_HEAVYOPS:
+                td->heavyops=counts[PERF_HEAVYOPS]/slots;
+                break;
+            case PERF_BRMISPREDICT:
+                td->brmispredict=counts[PERF_BRMISPREDICT]/slots;
+                break;
+            case PERF_FETCHLAT:
+                td->fetchlat=counts[PERF_FETCHLAT]/slots;
+                break;
+            case PERF_MEMBOUND:
+                td->membound=counts[PERF_MEMBOUND]/slots;
+                td->corebound=td->backend-td->membound;
+                if(td->corebound<(double)0.0) td->corebound=(double)0.0;
+                break;
+        }
+    return(0);
+}
+
+#else
+
+/*
+** Non-Linux systems have no counter interface we know about.
+*/
+int PerfAddTopdown(char *reason)
+{
+    strcpy(reason,"not supported on this system");
+    return(-1);
+}
+
+int PerfAddFrequency(char *reason)
+{
+    strcpy(reason,"not supported on this system");
+    return(-1);
+}
+
+int PerfHasAperf(void)
+{
+    return(0);
+}
+
+int PerfAddTlb(char *reason)
+{
+    strcpy(reason,"not supported on this system");
+    return(-1);
+}
+
+int PerfHasTlb(void)
+{
+    return(0);
+}
+
+void PerfThreadStart(void) { }
+
+void PerfThreadStop(double *counts)
+{
+    int i;
+    for(i=0;i<MAXPERFCOUNTERS;i++)
+        counts[i]=(double)0.0;
+}
+
+void PerfRegionBegin(void) { }
+
+void PerfRegionEnd(void) { }
+
+int PerfTopdown(double *counts, TopdownStruct *td)
+{
+    return(-1);
+}
+
+#endif
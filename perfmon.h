@@ -0,0 +1,61 @@
+/*
+** perfmon.h
+** Header for perfmon.c
+** Hardware performance counter support for the BYTEmark tests.
+*/
+
+/*
+** Counter slots.  Every counter read by a benchmark thread lands
+** in one of these slots of TestResultStruct.perfcount[].
+*/
+#define PERF_SLOTS 0            /* Top-down: total issue slots */
+#define PERF_RETIRING 1         /* Top-down: retiring slots */
+#define PERF_BADSPEC 2          /* Top-down: bad speculation slots */
+#define PERF_FEBOUND 3          /* Top-down: frontend bound slots */
+#define PERF_BEBOUND 4          /* Top-down: backend bound slots */
+#define PERF_HEAVYOPS 5         /* Top-down L2: heavy operations */
+#define PERF_BRMISPREDICT 6     /* Top-down L2: branch mispredicts */
+#define PERF_FETCHLAT 7         /* Top-down L2: fetch latency */
+#define PERF_MEMBOUND 8         /* Top-down L2: memory bound */
+#define PERF_SLOTSISSUED 9      /* Pre-Icelake top-down: slots issued */
+#define PERF_RECOVERY 10        /* Pre-Icelake top-down: recovery bubbles */
+#define PERF_APERF 11           /* Actual cycles while running */
+#define PERF_MPERF 12           /* Reference (nominal) cycles while running */
+#define PERF_DTLBLOADS 13       /* Loads looked up in the data TLB */
+#define PERF_DTLBMISSES 14      /* Of those, data TLB misses */
+
+/*
+** Top-down breakdown, as fractions of all issue slots.
+** Level 2 entries are negative when the host does not
+** expose the matching event.
+*/
+typedef struct {
+    double retiring;        /* Level 1 */
+    double badspec;
+    double frontend;
+    double backend;
+    double heavyops;        /* Level 2 (part of retiring) */
+    double brmispredict;    /* Level 2 (part of bad speculation) */
+    double fetchlat;        /* Level 2 (part of frontend) */
+    double membound;        /* Level 2 (part of backend) */
+    double corebound;       /* Level 2 (backend - membound) */
+} TopdownStruct;
+
+/*
+** EXTERNALS
+*/
+extern int global_topdown;      /* Top-down breakdown requested */
+
+/*
+** PROTOTYPES
+*/
+int PerfAddTopdown(char *reason);
+int PerfAddFrequency(char *reason);
+int PerfHasAperf(void);
+int PerfAddTlb(char *reason);
+int PerfHasTlb(void);
+void PerfThreadStart(void);
+void PerfThreadStop(double *counts);
+void PerfRegionBegin(void);
+void PerfRegionEnd(void);
+int PerfTopdown(double *counts, TopdownStruct *td);
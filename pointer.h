@@ -0,0 +1 @@
+#define LONG64
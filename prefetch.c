@@ -0,0 +1,150 @@
+/*
+** prefetch.c
+** Access-pattern sweep.
+**
+** Several BYTEmark kernels walk memory with a stride or in an
+** irregular order: the column walks of ludcmp() and of the
+** assignment test step 101 elements at a time, and NumSift()
+** jumps from a heap node to its children, twice as far each
+** level.  Whether those walks run at memory speed depends on
+** whether the hardware prefetchers follow them.  These routines
+** walk an array far larger than any cache with a given stride,
+** direction and number of interleaved streams and time every
+** access, so each pattern's rate shows what the prefetchers
+** make of it.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "sysspec.h"
+#include "prefetch.h"
+
+/*
+** Global parameters.
+*/
+int global_prefetch;            /* Prefetch sweep requested */
+ulong global_prefetchsize;      /* Bytes walked */
+ulong global_prefetchstride;    /* Largest stride, elements */
+
+#define PREF_LINEELEMS 8        /* Elements per 64-byte line */
+
+static long *pref_array;        /* The array walked */
+static ulong pref_n;            /* # of elements in it */
+
+/* Keeps the walks live */
+static volatile long pref_sink;
+
+/*
+** PROTOTYPES
+*/
+static long walk(long *a, ulong seg, ulong stride, int backward,
+        int streams, ulong start, ulong *naccess);
+
+/*********
+** walk **
+**********
+** One pass over the array, split into streams segments of seg
+** elements walked side by side: element start, start+stride, ...
+** of every segment in turn (from the far end if backward).
+** The number of loads is added to *naccess.
+*/
+static long walk(long *a, ulong seg, ulong stride, int backward,
+        int streams, ulong start, ulong *naccess)
+{
+    long sum;
+    long i;
+    int s;
+
+    sum=0L;
+    if(streams==1)
+    {   /*
+         ** Keep the common case free of the stream loop.
+         */
+        if(backward)
+            for(i=(long)(seg-1-start);i>=0;i-=(long)stride)
+                sum+=a[i];
+        else
+            for(i=(long)start;i<(long)seg;i+=(long)stride)
+                sum+=a[i];
+    }
+    else if(backward)
+    {   for(i=(long)(seg-1-start);i>=0;i-=(long)stride)
+            for(s=0;s<streams;s++)
+                sum+=a[(ulong)s*seg+(ulong)i];
+    }
+    else
+    {   for(i=(long)start;i<(long)seg;i+=(long)stride)
+            for(s=0;s<streams;s++)
+                sum+=a[(ulong)s*seg+(ulong)i];
+    }
+    *naccess+=((seg-start+stride-1)/stride)*(ulong)streams;
+    return(sum);
+}
+
+/*****************
+** PrefetchOpen **
+******************
+** Allocate the array of global_prefetchsize bytes and touch
+** every page of it.  Returns 0 if ok, -1 if it can't be
+** allocated; in that case reason holds a short explanation.
+*/
+int PrefetchOpen(char *reason)
+{
+    int systemerror;
+    ulong i;
+
+    pref_n=global_prefetchsize/sizeof(long);
+    pref_array=(long *)AllocateMemory(pref_n*sizeof(long),&systemerror);
+    if(systemerror)
+    {   pref_array=(long *)NULL;
+        strcpy(reason,"not enough memory for the sweep array");
+        return(-1);
+    }
+    for(i=0;i<pref_n;i++)
+        pref_array[i]=(long)i;
+    return(0);
+}
+
+/***************
+** PrefetchNs **
+****************
+** Walk the array with the given stride (in elements), direction
+** and number of streams for at least secs seconds and return
+** the mean time per load in ns.  Strides past a cache line start
+** each pass one line further on, so that a pass never finds the
+** lines of the one before in the cache.
+*/
+double PrefetchNs(ulong stride, int backward, int streams, double secs)
+{
+    StopWatchStruct stopwatch;
+    ulong seg, start, naccess, pass;
+
+    seg=pref_n/(ulong)streams;
+    if(stride<1) stride=1;
+    if(stride>seg) stride=seg;
+    naccess=0;
+    ResetStopWatch(&stopwatch);
+    for(pass=0;stopwatch.realsecs<secs;pass++)
+    {
+        start=stride>PREF_LINEELEMS ? (pass*PREF_LINEELEMS)%stride : 0;
+        StartStopWatch(&stopwatch);
+        pref_sink=walk(pref_array,seg,stride,backward,streams,start,&naccess);
+        StopStopWatch(&stopwatch);
+    }
+    return(stopwatch.realsecs/(double)naccess*1e9);
+}
+
+/******************
+** PrefetchClose **
+*******************
+** Free the sweep array.
+*/
+void PrefetchClose(void)
+{
+    int systemerror;
+
+    if(pref_array!=(long *)NULL)
+        FreeMemory((farvoid *)pref_array,&systemerror);
+    pref_array=(long *)NULL;
+}
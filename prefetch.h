@@ -0,0 +1,27 @@
+/*
+** prefetch.h
+** Header for prefetch.c
+** Access-pattern sweep to characterize the hardware prefetchers.
+*/
+
+/*
+** Defaults: the array walked, in bytes (at least; four times
+** the LLC where that is larger), and the largest stride, in
+** 8-byte elements.
+*/
+#define PREFETCHARRAYSIZE (256UL<<20)
+#define PREFETCHMAXSTRIDE 4096UL
+
+/*
+** EXTERNALS
+*/
+extern int global_prefetch;             /* Prefetch sweep requested */
+extern ulong global_prefetchsize;       /* Bytes walked */
+extern ulong global_prefetchstride;     /* Largest stride, elements */
+
+/*
+** PROTOTYPES
+*/
+int PrefetchOpen(char *reason);
+double PrefetchNs(ulong stride, int backward, int streams, double secs);
+void PrefetchClose(void);
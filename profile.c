@@ -0,0 +1,400 @@
+
+/*
+** profile.c
+** Sampling profiler for the benchmark threads.
+**
+** Every benchmark thread gets a CPU-time timer that sends it
+** SIGPROF at PROF_HZ.  The handler stores the interrupted program
+** counter in the thread's own ring buffer; nothing is shared with
+** other threads, so the handler needs no locks.  When the thread
+** ends it drains its ring into the per-test hit table, which is
+** indexed by the functions of the binary's own ELF symbol table.
+** This gives a hot-function table per test without needing perf
+** on the host.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "profile.h"
+
+#ifdef LINUX
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <link.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+** Global parameters.
+*/
+int global_profile;             /* Profiler requested */
+
+#ifdef LINUX
+
+#define PROF_HZ 1000            /* Samples per second of thread CPU time */
+#define PROF_RING 65536         /* Ring entries per thread */
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+/*
+** TYPEDEFS
+*/
+typedef struct {
+    unsigned long addr;     /* Run-time start address */
+    unsigned long size;     /* Size in bytes, 0 if unknown */
+    char *name;
+} ProfSymStruct;
+
+/*
+** Symbol table and hit counts.  prof_hits[prof_nsyms] collects
+** samples outside every known function.
+*/
+static ProfSymStruct *prof_syms;
+static long prof_nsyms;
+static long *prof_hits;
+static long prof_lost;          /* Samples dropped on full rings */
+static pthread_mutex_t prof_lock=PTHREAD_MUTEX_INITIALIZER;
+
+/*
+** Per-thread sampling state.  Only the owning thread and its
+** signal handler touch these.
+*/
+static __thread unsigned long * volatile prof_ring;
+static __thread volatile unsigned long prof_head;
+static __thread volatile long prof_dropped;
+static __thread timer_t prof_timer;
+
+/*
+** PROTOTYPES
+*/
+static int load_symbols(char *reason);
+static int sym_compare(const void *a, const void *b);
+static long find_symbol(unsigned long pc);
+static void prof_handler(int sig, siginfo_t *si, void *context);
+
+/****************
+** sym_compare **
+*****************
+** qsort() comparison for symbols, by address.
+*/
+static int sym_compare(const void *a, const void *b)
+{
+    const ProfSymStruct *x=(const ProfSymStruct *)a;
+    const ProfSymStruct *y=(const ProfSymStruct *)b;
+
+    if(x->addr<y->addr) return(-1);
+    return(x->addr>y->addr);
+}
+
+/*****************
+** load_symbols **
+******************
+** Read the function symbols of the running binary from its
+** .symtab and relocate them to where the binary is loaded (so
+** position-independent builds work too).
+** Returns 0 if ok, -1 if not; in that case reason holds a
+** short explanation.
+*/
+static int load_symbols(char *reason)
+{
+    FILE *fp;
+    long len, i, n, nsym;
+    char *image;
+    ElfW(Ehdr) *eh;
+    ElfW(Shdr) *sh, *symsh;
+    ElfW(Sym) *sym;
+    char *strtab;
+    unsigned long bias;
+    int found;
+
+    fp=fopen("/proc/self/exe","rb");
+    if(fp==(FILE *)NULL)
+    {   strcpy(reason,"cannot open /proc/self/exe");
+        return(-1);
+    }
+    fseek(fp,0L,SEEK_END);
+    len=ftell(fp);
+    fseek(fp,0L,SEEK_SET);
+    image=(char *)malloc(len);
+    if(image==(char *)NULL || fread(image,1,len,fp)!=(size_t)len)
+    {   fclose(fp);
+        free(image);
+        strcpy(reason,"cannot read /proc/self/exe");
+        return(-1);
+    }
+    fclose(fp);
+
+    eh=(ElfW(Ehdr) *)image;
+    if(len<(long)sizeof(ElfW(Ehdr)) || memcmp(eh->e_ident,ELFMAG,SELFMAG)!=0 ||
+            eh->e_ident[EI_CLASS]!=(sizeof(void *)==8 ? ELFCLASS64 : ELFCLASS32))
+    {   free(image);
+        strcpy(reason,"binary is not a native ELF file");
+        return(-1);
+    }
+    sh=(ElfW(Shdr) *)(image+eh->e_shoff);
+    symsh=(ElfW(Shdr) *)NULL;
+    for(i=0;i<eh->e_shnum;i++)
+        if(sh[i].sh_type==SHT_SYMTAB) symsh=&sh[i];
+    if(symsh==(ElfW(Shdr) *)NULL)
+    {   free(image);
+        strcpy(reason,"binary is stripped (build without -s)");
+        return(-1);
+    }
+    sym=(ElfW(Sym) *)(image+symsh->sh_offset);
+    nsym=symsh->sh_size/sizeof(ElfW(Sym));
+    strtab=image+sh[symsh->sh_link].sh_offset;
+
+    /*
+     ** Load bias: where ProfInit is now minus where the
+     ** symbol table says it is.
+     */
+    bias=0;
+    found=0;
+    for(i=0;i<nsym && !found;i++)
+        if(strcmp(strtab+sym[i].st_name,"ProfInit")==0)
+        {   bias=(unsigned long)ProfInit-(unsigned long)sym[i].st_value;
+            found=1;
+        }
+
+    prof_syms=(ProfSymStruct *)malloc(sizeof(ProfSymStruct)*nsym);
+    n=0;
+    for(i=0;i<nsym;i++)
+    {
+        if(ELF32_ST_TYPE(sym[i].st_info)!=STT_FUNC || sym[i].st_value==0)
+            continue;
+        prof_syms[n].addr=(unsigned long)sym[i].st_value+bias;
+        prof_syms[n].size=(unsigned long)sym[i].st_size;
+        prof_syms[n].name=strdup(strtab+sym[i].st_name);
+        n++;
+    }
+    free(image);
+    if(n==0)
+    {   strcpy(reason,"no function symbols in binary");
+        return(-1);
+    }
+    qsort(prof_syms,n,sizeof(ProfSymStruct),sym_compare);
+    prof_nsyms=n;
+    return(0);
+}
+
+/****************
+** find_symbol **
+*****************
+** Index of the function containing pc, or prof_nsyms if
+** there is none.
+*/
+static long find_symbol(unsigned long pc)
+{
+    long lo, hi, mid;
+
+    lo=0;
+    hi=prof_nsyms-1;
+    if(prof_nsyms==0 || pc<prof_syms[0].addr) return(prof_nsyms);
+    while(lo<hi)
+    {
+        mid=(lo+hi+1)/2;
+        if(prof_syms[mid].addr<=pc) lo=mid;
+        else hi=mid-1;
+    }
+    if(prof_syms[lo].size ? pc>=prof_syms[lo].addr+prof_syms[lo].size :
+            lo==prof_nsyms-1)
+        return(prof_nsyms);     /* Past the end, e.g. in the vDSO */
+    return(lo);
+}
+
+/*****************
+** prof_handler **
+******************
+** SIGPROF handler.  Appends the interrupted program counter to
+** the thread's ring; when the ring is full the sample is
+** dropped and counted.
+*/
+static void prof_handler(int sig, siginfo_t *si, void *context)
+{
+    ucontext_t *uc=(ucontext_t *)context;
+    unsigned long *ring=prof_ring;
+    unsigned long pc;
+
+    if(ring==(unsigned long *)NULL) return;
+#if defined(__x86_64__)
+    pc=(unsigned long)uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__i386__)
+    pc=(unsigned long)uc->uc_mcontext.gregs[REG_EIP];
+#elif defined(__aarch64__)
+    pc=(unsigned long)uc->uc_mcontext.pc;
+#else
+    pc=0;
+#endif
+    if(prof_head<PROF_RING)
+        ring[prof_head++]=pc;
+    else
+        prof_dropped++;
+}
+
+/*************
+** ProfInit **
+**************
+** Load the symbol table and install the SIGPROF handler.
+** Returns 0 if ok, -1 if the profiler can't run; in that case
+** reason holds a short explanation.
+*/
+int ProfInit(char *reason)
+{
+    struct sigaction sa;
+
+    if(load_symbols(reason)!=0) return(-1);
+    prof_hits=(long *)calloc(prof_nsyms+1,sizeof(long));
+
+    memset(&sa,0,sizeof(sa));
+    sa.sa_sigaction=prof_handler;
+    sa.sa_flags=SA_SIGINFO|SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if(sigaction(SIGPROF,&sa,(struct sigaction *)NULL)!=0)
+    {   strcpy(reason,"cannot install SIGPROF handler");
+        return(-1);
+    }
+    return(0);
+}
+
+/**************
+** ProfReset **
+***************
+** Clear the hit table before a new test.
+*/
+void ProfReset(void)
+{
+    if(prof_hits==(long *)NULL) return;
+    memset(prof_hits,0,sizeof(long)*(prof_nsyms+1));
+    prof_lost=0;
+}
+
+/********************
+** ProfThreadStart **
+*********************
+** Start sampling the calling benchmark thread.  If the timer
+** can't be set up the thread simply goes unsampled.
+*/
+void ProfThreadStart(void)
+{
+    struct sigevent sev;
+    struct itimerspec its;
+    unsigned long *ring;
+
+    if(!global_profile || prof_hits==(long *)NULL) return;
+    ring=(unsigned long *)malloc(sizeof(unsigned long)*PROF_RING);
+    if(ring==(unsigned long *)NULL) return;
+    prof_head=0;
+    prof_dropped=0;
+    prof_ring=ring;
+
+    memset(&sev,0,sizeof(sev));
+    sev.sigev_notify=SIGEV_THREAD_ID;
+    sev.sigev_signo=SIGPROF;
+    sev.sigev_notify_thread_id=(pid_t)syscall(SYS_gettid);
+    if(timer_create(CLOCK_THREAD_CPUTIME_ID,&sev,&prof_timer)!=0)
+    {   prof_ring=(unsigned long *)NULL;
+        free(ring);
+        return;
+    }
+    its.it_interval.tv_sec=0;
+    its.it_interval.tv_nsec=1000000000L/PROF_HZ;
+    its.it_value=its.it_interval;
+    timer_settime(prof_timer,0,&its,(struct itimerspec *)NULL);
+}
+
+/*******************
+** ProfThreadStop **
+********************
+** Stop sampling the calling thread and fold its samples into
+** the hit table.
+*/
+void ProfThreadStop(void)
+{
+    unsigned long *ring;
+    unsigned long i;
+
+    ring=prof_ring;
+    if(ring==(unsigned long *)NULL) return;
+    timer_delete(prof_timer);
+    prof_ring=(unsigned long *)NULL;    /* Late signals are ignored */
+
+    pthread_mutex_lock(&prof_lock);
+    for(i=0;i<prof_head;i++)
+        prof_hits[find_symbol(ring[i])]++;
+    prof_lost+=prof_dropped;
+    pthread_mutex_unlock(&prof_lock);
+    free(ring);
+}
+
+/************
+** ProfTop **
+*************
+** Fill top[] with up to n of the functions hit most since
+** the last ProfReset(), most frequent first.  Sets *total to
+** the number of samples taken and *lost to those dropped.
+** Returns the number of entries filled.
+*/
+int ProfTop(ProfEntryStruct *top, int n, long *total, long *lost)
+{
+    long i;
+    int j, k;
+
+    *total=0;
+    *lost=prof_lost;
+    if(prof_hits==(long *)NULL) return(0);
+    k=0;
+    for(i=0;i<=prof_nsyms;i++)
+    {
+        if(prof_hits[i]==0) continue;
+        *total+=prof_hits[i];
+        /*
+         ** Insertion into the sorted top list.
+         */
+        if(k<n) j=k++;
+        else if(top[n-1].hits<prof_hits[i]) j=n-1;
+        else continue;
+        for(;j>0 && top[j-1].hits<prof_hits[i];j--)
+            top[j]=top[j-1];
+        top[j].hits=prof_hits[i];
+        top[j].name=i<prof_nsyms ? prof_syms[i].name : "[unknown]";
+    }
+    return(k);
+}
+
+#else
+
+/*
+** Elsewhere there is no profiler.
+*/
+int ProfInit(char *reason)
+{
+    strcpy(reason,"not supported on this system");
+    return(-1);
+}
+
+void ProfReset(void)
+{
+}
+
+void ProfThreadStart(void)
+{
+}
+
+void ProfThreadStop(void)
+{
+}
+
+int ProfTop(ProfEntryStruct *top, int n, long *total, long *lost)
+{
+    *total=*lost=0;
+    return(0);
+}
+
+#endif
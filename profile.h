@@ -0,0 +1,27 @@
+/*
+** profile.h
+** Header for profile.c
+** Sampling profiler for the benchmark threads.
+*/
+
+/*
+** TYPEDEFS
+*/
+typedef struct {
+    char *name;             /* Function name */
+    long hits;              /* Samples that landed in it */
+} ProfEntryStruct;
+
+/*
+** EXTERNALS
+*/
+extern int global_profile;      /* Profiler requested */
+
+/*
+** PROTOTYPES
+*/
+int ProfInit(char *reason);
+void ProfReset(void);
+void ProfThreadStart(void);
+void ProfThreadStop(void);
+int ProfTop(ProfEntryStruct *top, int n, long *total, long *lost);
@@ -0,0 +1,358 @@
+
+/*
+** roofline.c
+** Peak compute and memory bandwidth probes.
+**
+** A roofline puts each kernel at its arithmetic intensity
+** (operations per byte of memory traffic) under two roofs: the
+** peak operation rate of the core and the bandwidth of the
+** memory system.  The probes below measure both roofs with code
+** compiled exactly like the benchmarks themselves, so the roofs
+** are the ones those kernels can actually reach: independent
+** multiply-add chains for the compute roofs and a STREAM-style
+** triad over arrays far larger than any cache for bandwidth.
+** The compute roofs are those of one thread; the bandwidth roof
+** is measured on as many threads as the tests run on.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "sysspec.h"
+#include "roofline.h"
+#include "hardware.h"
+
+#if defined(LINUX) || defined(OSX)
+#include <pthread.h>
+#include <time.h>
+#endif
+
+/*
+** Global parameters.
+*/
+int global_roofline;            /* Roofline placement requested */
+
+#define ROOF_SECS 0.1           /* Run each probe at least this long */
+#define ROOF_CHUNK 100000L      /* Probe loop trips between clock reads */
+#define ROOF_STREAMN 4194304L   /* Fewest triad elements per array (32 MB) */
+#define ROOF_STREAMTRIES 5      /* Best of this many triads */
+
+/*
+** Work of one bandwidth probe thread.
+*/
+typedef struct {
+    long n;                 /* Triad elements per array */
+    int failed;             /* Could not get its arrays */
+} RoofThreadStruct;
+
+/*
+** The probe threads meet in roof_sync() before and after every
+** triad; the last to arrive times the triad for all of them.
+*/
+static int roof_threads;        /* Threads in step */
+static double roof_best;        /* Fastest triad, seconds */
+#if defined(LINUX) || defined(OSX)
+static int roof_waiting;        /* Threads at the meeting point */
+static int roof_generation;     /* Meetings so far */
+static double roof_release;     /* Time of the last release */
+static pthread_mutex_t roof_lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t roof_met=PTHREAD_COND_INITIALIZER;
+#else
+static int roof_waiting;
+#endif
+
+/*
+** PROTOTYPES
+*/
+static double flop_kernel(long n);
+static u32 iop_kernel(long n);
+static double triad(double *a, double *b, double *c, long n);
+static int roof_bandwidth(RoofStruct *roof, char *reason);
+static void *roof_thread(void *data);
+static void roof_sync(int finished);
+
+/* Keeps the probe results live */
+static volatile double roof_sink;
+
+/****************
+** flop_kernel **
+*****************
+** Eight independent multiply-add chains; 16 floating-point
+** operations per trip.
+*/
+static double flop_kernel(long n)
+{
+    double a0=1.0, a1=1.1, a2=1.2, a3=1.3, a4=1.4, a5=1.5, a6=1.6, a7=1.7;
+    double m=0.999999, c=1e-7;
+    long i;
+
+    for(i=0;i<n;i++)
+    {
+        a0=a0*m+c; a1=a1*m+c; a2=a2*m+c; a3=a3*m+c;
+        a4=a4*m+c; a5=a5*m+c; a6=a6*m+c; a7=a7*m+c;
+    }
+    return(a0+a1+a2+a3+a4+a5+a6+a7);
+}
+
+/***************
+** iop_kernel **
+****************
+** Integer counterpart of flop_kernel: eight independent
+** add/xor chains, 16 integer operations per trip.
+*/
+static u32 iop_kernel(long n)
+{
+    u32 x0=1, x1=2, x2=3, x3=4, x4=5, x5=6, x6=7, x7=8;
+    u32 k=(u32)n|1;
+    long i;
+
+    for(i=0;i<n;i++)
+    {
+        x0=(x0+k)^x1; x1=(x1+k)^x2; x2=(x2+k)^x3; x3=(x3+k)^x4;
+        x4=(x4+k)^x5; x5=(x5+k)^x6; x6=(x6+k)^x7; x7=(x7+k)^x0;
+    }
+    return(x0+x1+x2+x3+x4+x5+x6+x7);
+}
+
+/**********
+** triad **
+***********
+** STREAM triad, a=b+s*c.  Counts 24 bytes per element, as
+** STREAM does.
+*/
+static double triad(double *a, double *b, double *c, long n)
+{
+    double s=3.0;
+    long i;
+
+    for(i=0;i<n;i++)
+        a[i]=b[i]+s*c[i];
+    return(a[n/2]);
+}
+
+/**************
+** RoofProbe **
+***************
+** Measure the compute and bandwidth roofs.
+** Returns 0 if ok, -1 if the triad arrays can't be allocated;
+** in that case reason holds a short explanation.
+*/
+int RoofProbe(RoofStruct *roof, char *reason)
+{
+    StopWatchStruct stopwatch;
+    double trips;
+
+    /*
+     ** Compute roofs.
+     */
+    ResetStopWatch(&stopwatch);
+    trips=(double)0.0;
+    do {
+        StartStopWatch(&stopwatch);
+        roof_sink=flop_kernel(ROOF_CHUNK);
+        StopStopWatch(&stopwatch);
+        trips+=(double)ROOF_CHUNK;
+    } while(stopwatch.realsecs<ROOF_SECS);
+    roof->gflops=(double)16.0*trips/stopwatch.realsecs*1e-9;
+
+    ResetStopWatch(&stopwatch);
+    trips=(double)0.0;
+    do {
+        StartStopWatch(&stopwatch);
+        roof_sink=(double)iop_kernel(ROOF_CHUNK);
+        StopStopWatch(&stopwatch);
+        trips+=(double)ROOF_CHUNK;
+    } while(stopwatch.realsecs<ROOF_SECS);
+    roof->giops=(double)16.0*trips/stopwatch.realsecs*1e-9;
+
+    /*
+     ** Bandwidth roof.
+     */
+    return(roof_bandwidth(roof,reason));
+}
+
+/*******************
+** roof_bandwidth **
+********************
+** Measure the bandwidth roof with global_concurrency threads,
+** the threads the tests run on, since one core alone can't
+** saturate the memory controllers.  Every thread triads over
+** arrays of its own, allocated and first touched by itself;
+** together the arrays of one kind are four times the last-level
+** caches the threads can spread over (one per thread, up to
+** LLCDomains()), as STREAM's, so that the roof is that of
+** memory and not of the LLC, and at least ROOF_STREAMN
+** elements.  All
+** threads start each triad together and it is timed until the
+** last one is done; the best of ROOF_STREAMTRIES counts.
+** Returns 0 if ok, -1 if the arrays can't be allocated.
+*/
+static int roof_bandwidth(RoofStruct *roof, char *reason)
+{
+    RoofThreadStruct *rt;
+#if defined(LINUX) || defined(OSX)
+    pthread_t *tids;
+#endif
+    long n;
+    int threads, llcs, i;
+
+    threads=global_concurrency;
+    llcs=LLCDomains();
+    if(llcs>threads)
+        llcs=threads;
+    n=(long)(4UL*(ulong)llcs*LLCSize()/(ulong)sizeof(double));
+    if(n<ROOF_STREAMN)
+        n=ROOF_STREAMN;
+    rt=(RoofThreadStruct *)malloc(sizeof(RoofThreadStruct)*threads);
+    if(rt==(RoofThreadStruct *)NULL)
+    {   roof->gbs=(double)0.0;
+        strcpy(reason,"not enough memory for the bandwidth probe");
+        return(-1);
+    }
+#if defined(LINUX) || defined(OSX)
+    tids=(pthread_t *)malloc(sizeof(pthread_t)*threads);
+    if(tids==(pthread_t *)NULL)
+    {   free(rt);
+        roof->gbs=(double)0.0;
+        strcpy(reason,"not enough memory for the bandwidth probe");
+        return(-1);
+    }
+#else
+    threads=1;
+#endif
+
+    roof_threads=threads;
+    roof_waiting=0;
+    roof_best=(double)0.0;
+    for(i=0;i<threads;i++)
+    {   rt[i].n=n/threads;
+        rt[i].failed=0;
+    }
+#if defined(LINUX) || defined(OSX)
+    for(i=1;i<threads;i++)
+        if(pthread_create(&tids[i],0,roof_thread,&rt[i])!=0)
+            break;
+    if(i<threads)
+    {
+        /*
+         ** Meet with the threads that did start, once per
+         ** meeting point, so that they can finish.
+         */
+#if defined(LINUX) || defined(OSX)
+        pthread_mutex_lock(&roof_lock);
+        roof_threads=i;
+        pthread_mutex_unlock(&roof_lock);
+#endif
+        rt[0].failed=1;
+    }
+#endif
+    roof_thread(&rt[0]);
+#if defined(LINUX) || defined(OSX)
+    while(--i>0)
+        pthread_join(tids[i],0);
+    free(tids);
+#endif
+
+    for(i=0;i<roof_threads;i++)
+        if(rt[i].failed)
+        {   free(rt);
+            roof->gbs=(double)0.0;
+            strcpy(reason,"not enough memory or threads for the bandwidth probe");
+            return(-1);
+        }
+    free(rt);
+    roof->gbs=roof_best>(double)0.0 ?
+        (double)24.0*(double)(n/threads*threads)/roof_best*1e-9 : (double)0.0;
+    return(0);
+}
+
+/****************
+** roof_thread **
+*****************
+** One thread of roof_bandwidth(): allocate and touch its arrays,
+** then triad in step with the others.  A thread that has no
+** arrays still keeps step, doing no work.
+*/
+static void *roof_thread(void *data)
+{
+    RoofThreadStruct *rt;
+    double *a, *b, *c;
+    int systemerror;
+    long i, n;
+    int t;
+
+    rt=(RoofThreadStruct *)data;
+    n=rt->n;
+    a=(double *)AllocateMemory(3*sizeof(double)*n,&systemerror);
+    if(systemerror)
+    {   rt->failed=1;
+        a=(double *)NULL;
+        n=0;
+    }
+    b=a+n;
+    c=b+n;
+    for(i=0;i<n;i++)
+    {   a[i]=(double)0.0;
+        b[i]=(double)1.0;
+        c[i]=(double)2.0;
+    }
+    for(t=0;t<ROOF_STREAMTRIES;t++)
+    {
+        roof_sync(0);
+        if(n>0)
+            roof_sink=triad(a,b,c,n);
+        roof_sync(1);
+    }
+    if(a!=(double *)NULL)
+        FreeMemory((farvoid *)a,&systemerror);
+    return 0;
+}
+
+/**************
+** roof_sync **
+***************
+** Wait until every probe thread gets here.  The last to arrive
+** notes the time and, if finished is set, keeps the time since
+** the previous meeting if it is the best so far.
+*/
+static void roof_sync(int finished)
+{
+#if defined(LINUX) || defined(OSX)
+    struct timespec ts;
+    double now;
+    int generation;
+
+    pthread_mutex_lock(&roof_lock);
+    generation=roof_generation;
+    if(++roof_waiting<roof_threads)
+    {   while(generation==roof_generation)
+            pthread_cond_wait(&roof_met,&roof_lock);
+    }
+    else
+    {
+        clock_gettime(CLOCK_MONOTONIC,&ts);
+        now=(double)ts.tv_sec+(double)ts.tv_nsec*1e-9;
+        if(finished && now>roof_release &&
+                (roof_best==(double)0.0 || now-roof_release<roof_best))
+            roof_best=now-roof_release;
+        roof_release=now;
+        roof_waiting=0;
+        roof_generation++;
+        pthread_cond_broadcast(&roof_met);
+    }
+    pthread_mutex_unlock(&roof_lock);
+#else
+    static StopWatchStruct watch;
+
+    if(!finished)
+    {   ResetStopWatch(&watch);
+        StartStopWatch(&watch);
+        return;
+    }
+    StopStopWatch(&watch);
+    if(watch.realsecs>(double)0.0 &&
+            (roof_best==(double)0.0 || watch.realsecs<roof_best))
+        roof_best=watch.realsecs;
+#endif
+}
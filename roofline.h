@@ -0,0 +1,24 @@
+/*
+** roofline.h
+** Header for roofline.c
+** Peak compute and memory bandwidth probes for roofline placement.
+*/
+
+/*
+** TYPEDEFS
+*/
+typedef struct {
+    double gflops;          /* Peak double precision GFLOP/s, one thread */
+    double giops;           /* Peak integer Gop/s, one thread */
+    double gbs;             /* STREAM triad GB/s, all test threads */
+} RoofStruct;
+
+/*
+** EXTERNALS
+*/
+extern int global_roofline;     /* Roofline placement requested */
+
+/*
+** PROTOTYPES
+*/
+int RoofProbe(RoofStruct *roof, char *reason);
@@ -0,0 +1,282 @@
+
+/*
+** stream.c
+** Sustainable memory bandwidth test.
+**
+** The BYTEmark kernels all run out of cache on a current host,
+** so none of the indexes says much about the memory system.
+** This test runs the four STREAM kernels (copy, scale, add and
+** triad) over arrays several times larger than the last level
+** cache and reports the bandwidth each one sustains.  Every
+** thread allocates and first touches its own arrays so that on
+** a NUMA host the pages land on the thread's own node.  As in
+** STREAM, all threads start each kernel together and the kernel
+** is timed until the last one is done, so the per-kernel
+** bandwidths are those of the whole team.  The score is STREAM
+** passes per second; it does not count toward any index.
+*/
+
+/*
+** INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "sysspec.h"
+#include "misc.h"
+
+#if defined(LINUX) || defined(OSX)
+#include <pthread.h>
+#include <time.h>
+#endif
+
+/*
+** Bytes each kernel moves per array element, counted the way
+** STREAM counts them (no write-allocate traffic).
+*/
+static double stream_bytes[STREAMKERNELS] = {
+        16.0,                   /* Copy:  c=a */
+        16.0,                   /* Scale: b=s*c */
+        24.0,                   /* Add:   c=a+b */
+        24.0 };                 /* Triad: a=b+s*c */
+
+/*
+** Bandwidth of the last run, all threads together, GB/s.
+*/
+double global_streamgbs[STREAMKERNELS];
+
+/*
+** The threads meet in stream_sync() before and after every
+** kernel.  The last to arrive releases the others, adds the
+** time since the previous release to the kernel's team time
+** and, after the triad, decides whether the run is over, so
+** that every thread does the same number of passes.
+*/
+static double stream_secs[STREAMKERNELS];  /* Team time per kernel */
+static double stream_request;   /* Seconds to run for */
+static int stream_done;         /* Enough passes */
+#if defined(LINUX) || defined(OSX)
+static int stream_waiting;      /* Threads at the meeting point */
+static int stream_generation;   /* Meetings so far */
+static double stream_release;   /* Time of the last release */
+static pthread_mutex_t stream_lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stream_met=PTHREAD_COND_INITIALIZER;
+#endif
+
+/*
+** PROTOTYPES
+*/
+void DoStream(void);
+static void *StreamFunc(void *data);
+static int DoStreamIteration(double *a, double *b, double *c,
+        ulong n, StopWatchStruct *kernwatch);
+static int stream_sync(int kernel, int finished);
+
+/*************
+** DoStream **
+**************
+** Perform the STREAM bandwidth test.  There is nothing to
+** adjust: the arrays are sized to defeat the caches, so a
+** single pass already runs for a measurable time.
+*/
+void DoStream(void)
+{
+    TestControlStruct *locstreamstruct;   /* Local stream structure */
+    int k;
+
+    locstreamstruct=&global_streamstruct;
+    for(k=0;k<STREAMKERNELS;k++)
+        stream_secs[k]=(double)0.0;
+    stream_request=(double)locstreamstruct->request_secs;
+    stream_done=0;
+#if defined(LINUX) || defined(OSX)
+    stream_waiting=0;
+#endif
+    locstreamstruct->adjust=1;
+
+    run_bench_with_concurrency(locstreamstruct, StreamFunc);
+
+    /*
+     ** result.iterations counts the passes of all threads.
+     */
+    for(k=0;k<STREAMKERNELS;k++)
+        global_streamgbs[k]=stream_secs[k]>(double)0.0 ?
+            stream_bytes[k]*(double)locstreamstruct->arraysize*
+            locstreamstruct->result.iterations/stream_secs[k]*1e-9 :
+            (double)0.0;
+}
+
+/***************
+** StreamFunc **
+****************
+** Body of one STREAM thread.  The arrays are allocated and
+** initialized here, by the thread that will use them, as one
+** block so that each thread holds a single entry of the
+** memory array.
+*/
+static void *StreamFunc(void *data)
+{
+    TestThreadData *testdata;       /* test data passed from thread func */
+    TestControlStruct *locstreamstruct;     /* Local pointer to global struct */
+    StopWatchStruct kernwatch[STREAMKERNELS];  /* One stop watch per kernel */
+    double *a, *b, *c;              /* The three arrays, in a */
+    double realsecs, cpusecs;
+    int systemerror;                /* For holding error code */
+    ulong n, i;
+    int k;
+
+    testdata=(TestThreadData *)data;
+    locstreamstruct=testdata->control;
+    n=locstreamstruct->arraysize;
+
+    a=(double *)AllocateMemory(3*n*sizeof(double),&systemerror);
+    if(systemerror)
+    {
+        ReportError(locstreamstruct->errorcontext,systemerror);
+        ErrorExit();
+    }
+    b=a+n;
+    c=b+n;
+
+    /*
+     ** First touch, from this thread.
+     */
+    for(i=0;i<n;i++)
+    {   a[i]=(double)1.0;
+        b[i]=(double)2.0;
+        c[i]=(double)0.0;
+    }
+
+    testdata->result.iterations=0.0;
+    for(k=0;k<STREAMKERNELS;k++)
+        ResetStopWatch(&kernwatch[k]);
+    do {
+        testdata->result.iterations+=(double)1.0;
+    } while(!DoStreamIteration(a,b,c,n,kernwatch));
+
+    /*
+     ** Clean up, calculate results, and go home.
+     */
+    FreeMemory((farvoid *)a,&systemerror);
+
+    realsecs=(double)0.0;
+    for(k=0;k<STREAMKERNELS;k++)
+        realsecs+=kernwatch[k].realsecs;
+    cpusecs=(double)0.0;
+    for(k=0;k<STREAMKERNELS;k++)
+        cpusecs+=kernwatch[k].cpusecs;
+    testdata->result.cpusecs=cpusecs;
+    testdata->result.realsecs=realsecs;
+
+    return 0;
+}
+
+/**********************
+** DoStreamIteration **
+***********************
+** One STREAM pass: the four kernels in turn, each timed on
+** its own stop watch and started and finished together with
+** the other threads.  The meeting points are inside the stop
+** watch, after the cold-cache eviction.  Returns nonzero when
+** the run is over.
+*/
+static int DoStreamIteration(double *a, double *b, double *c,
+        ulong n, StopWatchStruct *kernwatch)
+{
+    double s=0.41421356237309515;   /* sqrt(2)-1: keeps values steady */
+    ulong i;
+    int done;
+
+    StartStopWatch(&kernwatch[STREAM_COPY]);
+    stream_sync(STREAM_COPY,0);
+    for(i=0;i<n;i++)
+        c[i]=a[i];
+    stream_sync(STREAM_COPY,1);
+    StopStopWatch(&kernwatch[STREAM_COPY]);
+
+    StartStopWatch(&kernwatch[STREAM_SCALE]);
+    stream_sync(STREAM_SCALE,0);
+    for(i=0;i<n;i++)
+        b[i]=s*c[i];
+    stream_sync(STREAM_SCALE,1);
+    StopStopWatch(&kernwatch[STREAM_SCALE]);
+
+    StartStopWatch(&kernwatch[STREAM_ADD]);
+    stream_sync(STREAM_ADD,0);
+    for(i=0;i<n;i++)
+        c[i]=a[i]+b[i];
+    stream_sync(STREAM_ADD,1);
+    StopStopWatch(&kernwatch[STREAM_ADD]);
+
+    StartStopWatch(&kernwatch[STREAM_TRIAD]);
+    stream_sync(STREAM_TRIAD,0);
+    for(i=0;i<n;i++)
+        a[i]=b[i]+s*c[i];
+    done=stream_sync(STREAM_TRIAD,1);
+    StopStopWatch(&kernwatch[STREAM_TRIAD]);
+    return(done);
+}
+
+/****************
+** stream_sync **
+*****************
+** Wait until every thread has reached this point: the start
+** of kernel, or its end if finished is set.  The last thread
+** to arrive books the kernel's team time and, at the end of
+** the triad, decides whether the run is over.  Returns nonzero
+** when it is.  Without threads the kernel is timed alone.
+*/
+static int stream_sync(int kernel, int finished)
+{
+#if defined(LINUX) || defined(OSX)
+    struct timespec ts;
+    double now;
+    int generation, k;
+
+    pthread_mutex_lock(&stream_lock);
+    generation=stream_generation;
+    if(++stream_waiting<global_concurrency)
+    {   while(generation==stream_generation)
+            pthread_cond_wait(&stream_met,&stream_lock);
+    }
+    else
+    {
+        clock_gettime(CLOCK_MONOTONIC,&ts);
+        now=(double)ts.tv_sec+(double)ts.tv_nsec*1e-9;
+        if(finished)
+            stream_secs[kernel]+=now-stream_release;
+        stream_release=now;
+        if(finished && kernel==STREAM_TRIAD)
+        {   now=(double)0.0;
+            for(k=0;k<STREAMKERNELS;k++)
+                now+=stream_secs[k];
+            stream_done=now>=stream_request;
+        }
+        stream_waiting=0;
+        stream_generation++;
+        pthread_cond_broadcast(&stream_met);
+    }
+    finished=stream_done;
+    pthread_mutex_unlock(&stream_lock);
+    return(finished);
+#else
+    static StopWatchStruct watch;
+    int k;
+
+    if(!finished)
+    {   ResetStopWatch(&watch);
+        StartStopWatch(&watch);
+        return(0);
+    }
+    StopStopWatch(&watch);
+    stream_secs[kernel]+=watch.realsecs;
+    if(kernel==STREAM_TRIAD)
+    {   watch.realsecs=(double)0.0;
+        for(k=0;k<STREAMKERNELS;k++)
+            watch.realsecs+=stream_secs[k];
+        stream_done=watch.realsecs>=stream_request;
+    }
+    return(stream_done);
+#endif
+}
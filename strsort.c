@@ -60,6 +60,8 @@ void DoStringSortAdjust(TestControlStruct *strsortstruct);
 
 static void *StringSortFunc(void *data);
 static void DoStringSortIteration(faruchar *arraybase,
+		farulong *pristine,
+		ulong pnstrings,
 		uint numarrays,
 		ulong arraysize,
         StopWatchStruct *stopwatch);
@@ -67,6 +69,11 @@ static farulong *LoadStringArray(faruchar *strarray,
 		uint numarrays,
 		ulong *strings,
 		ulong arraysize);
+static void RestoreStringArray(faruchar *strarray,
+		farulong *optrarray,
+		uint numarrays,
+		ulong nstrings,
+		ulong arraysize);
 static void stradjust(farulong *optrarray,
 		faruchar *strarray,
 		ulong nstrings,
@@ -156,6 +163,7 @@ void DoStringSortAdjust(TestControlStruct *strsortstruct)
              ** an additional array, and try again.
              */
             DoStringSortIteration(arraybase,
+                        (farulong *)NULL,0L,
                         strsortstruct->numarrays,
                         strsortstruct->arraysize, &stopwatch);
 
@@ -174,6 +182,8 @@ void *StringSortFunc(void *data)
 {
     TestThreadData *testdata;       /* test data passed from thread func */
     faruchar *arraybase;            /* Base pointer of char array */
+    farulong *optrarray;            /* Offset pointer array */
+    ulong nstrings;                 /* # of strings in each array */
     StopWatchStruct stopwatch;      /* Stop watch to time the test */
     int systemerror;                /* For holding error code */
     TestControlStruct *strsortstruct;      /* Local pointer to global struct */
@@ -182,15 +192,19 @@ void *StringSortFunc(void *data)
     strsortstruct = testdata->control;
 
     /*
-     ** Allocate the space for the array.
+     ** Allocate the space for the array, and one array more
+     ** than are sorted: it and its offset pointers keep the
+     ** input, generated once, for every iteration to restore.
      */
     arraybase=(faruchar *)AllocateMemory((strsortstruct->arraysize+100L) *
-                (long)strsortstruct->numarrays,&systemerror);
+                (long)(strsortstruct->numarrays+1),&systemerror);
     if(systemerror)
     {
          ReportError(strsortstruct->errorcontext,systemerror);
          ErrorExit();
     }
+    optrarray=LoadStringArray(arraybase,strsortstruct->numarrays+1,
+                &nstrings,strsortstruct->arraysize);
 
     /*
      ** All's well if we get here.  Repeatedly perform sorts until the
@@ -201,6 +215,7 @@ void *StringSortFunc(void *data)
 
     do {
         DoStringSortIteration(arraybase,
+                optrarray,nstrings,
                 strsortstruct->numarrays,
                 strsortstruct->arraysize,
                 &stopwatch);
@@ -212,6 +227,7 @@ void *StringSortFunc(void *data)
      ** Set flag to show we don't need to rerun adjustment code.
      */
     FreeMemory((farvoid *)arraybase,&systemerror);
+    FreeMemory((farvoid *)optrarray,&systemerror);
 
     testdata->result.cpusecs = stopwatch.cpusecs;
     testdata->result.realsecs = stopwatch.realsecs;
@@ -225,8 +241,13 @@ void *StringSortFunc(void *data)
 ** sort benchmark.  It returns the number of ticks
 ** Note that this routine also builds the offset pointer
 ** array.
+** Given the offset pointers pristine of pnstrings strings,
+** built for one array more than numarrays, the arrays are
+** restored from that last one instead; with FRESHDATA every
+** iteration still builds its own.
 */
 static void DoStringSortIteration(faruchar *arraybase,
+        farulong *pristine,ulong pnstrings,
         uint numarrays,ulong arraysize,StopWatchStruct *stopwatch)
 {
     farulong *optrarray;            /* Offset pointer array */
@@ -239,7 +260,13 @@ static void DoStringSortIteration(faruchar *arraybase,
     /*
      ** Load up the array(s) with random numbers
      */
-    optrarray=LoadStringArray(arraybase,numarrays,&nstrings,arraysize);
+    if(pristine!=(farulong *)NULL && !global_freshdata)
+    {   nstrings=pnstrings;
+        optrarray=pristine;
+        RestoreStringArray(arraybase,optrarray,numarrays,nstrings,arraysize);
+    }
+    else
+        optrarray=LoadStringArray(arraybase,numarrays,&nstrings,arraysize);
 
     /*
      ** Set temp base pointers...they will be modified as the
@@ -290,7 +317,8 @@ static void DoStringSortIteration(faruchar *arraybase,
      ** Release the offset pointer array built by
      ** LoadStringArray()
      */
-    FreeMemory((farvoid *)optrarray,&syserror);
+    if(optrarray!=pristine)
+        FreeMemory((farvoid *)optrarray,&syserror);
 }
 
 /********************
@@ -323,7 +351,7 @@ static farulong *LoadStringArray(faruchar *strarray, /* String array */
      ** Initialize random number generator.
      */
     /* randnum(13L); */
-    randnum((int32)13);
+    randdata();
 
     /*
      ** Start with no strings.  Initialize our current offset pointer
@@ -432,6 +460,33 @@ static farulong *LoadStringArray(faruchar *strarray, /* String array */
     return(optrarray);
 }
 
+/***********************
+** RestoreStringArray **
+************************
+** Copy the string array after the last of numarrays, and its
+** offset pointers, into each of the numarrays arrays.
+*/
+static void RestoreStringArray(faruchar *strarray,
+    farulong *optrarray,
+    uint numarrays,
+    ulong nstrings,
+    ulong arraysize)
+{
+    faruchar *pstrings;             /* Pristine strings */
+    farulong *poptrs;               /* Pristine offset pointers */
+    unsigned int k;                 /* Index */
+
+    pstrings=strarray+(ulong)numarrays*(arraysize+100);
+    poptrs=optrarray+(ulong)numarrays*nstrings;
+    for(k=0;k<numarrays;k++)
+    {   memcpy((void *)(strarray+(ulong)k*(arraysize+100)),
+                (void *)pstrings,(size_t)arraysize);
+        memcpy((void *)(optrarray+(ulong)k*nstrings),
+                (void *)poptrs,(size_t)nstrings*sizeof(ulong));
+    }
+    return;
+}
+
 /**************
 ** stradjust **
 ***************
@@ -639,10 +694,14 @@ static void strsift(farulong *optrarray,        /* Offset pointers */
     {
         k=i+i;
         if(k<j)
+        {   OPCOUNT_ADD(OP_COMPARE,1);
             if(str_is_less(optrarray,strarray,numstrings,k,k+1L))
                 ++k;
+        }
+        OPCOUNT_ADD(OP_COMPARE,1);
         if(str_is_less(optrarray,strarray,numstrings,i,k))
         {
+            OPCOUNT_ADD(OP_SWAP,1);
             /* temp=string[k] */
             tlen=*(strarray+*(optrarray+k));
             MoveMemory((farvoid *)&temp[0],
@@ -0,0 +1,10 @@
+sprintf(buffer,"**System used for compilation:\n");
+output_string(buffer);
+sprintf(buffer,"**Linux vm 6.18.44-fc-v139 #1 SMP PREEMPT_DYNAMIC @0 x86_64 GNU/Linux\n");
+output_string(buffer);
+sprintf(buffer,"**C compiler: gcc version 12.2.0 (Debian 12.2.0-14+deb12u1) \n");
+output_string(buffer);
+sprintf(buffer,"**libc: /lib/x86_64-linux-gnu/libc.so.6\n");
+output_string(buffer);
+sprintf(buffer,"**Date of compilation: Mon Oct 19 01:50:59 UTC 2026\n");
+output_string(buffer);
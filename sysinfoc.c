@@ -0,0 +1,4 @@
+sprintf(buffer,"C compiler          : gcc version 12.2.0 (Debian 12.2.0-14+deb12u1) \n");
+output_string(buffer);
+sprintf(buffer,"libc                : /lib/x86_64-linux-gnu/libc.so.6\n");
+output_string(buffer);
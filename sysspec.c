@@ -36,6 +36,13 @@
 */
 #include "nmglobal.h"
 #include "sysspec.h"
+#include "perfmon.h"
+#include "noisemon.h"
+#include "freqmon.h"
+#include "energy.h"
+#include "trace.h"
+#include "cold.h"
+#include "movemem.h"
 
 #ifdef DOS16
 #include <io.h>
@@ -47,25 +54,61 @@
 #if defined(LINUX) || defined(OSX)
 #include <pthread.h>
 #endif
+#ifdef LINUX
+#include <sys/mman.h>
+#endif
+
+#ifdef TSC_TIMER
+#include <cpuid.h>
+#include <x86intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#endif
 
 /*
 ** Global parameters.
 */
 int global_align;		/* Memory alignment */
+int global_hugepages;           /* Page policy for large blocks (HUGE_xxx) */
+long global_offset = OFFSET_NONE; /* Page offset of blocks (OFFSET_xxx) */
 #ifdef CLOCK_GETTIME
 int global_realtime_cid = CLOCK_MONOTONIC;  /* Clock ID used in clock_gettime */
 #endif
+double global_sw_overhead_real; /* Stopwatch cost inside a timed region */
+double global_sw_overhead_cpu;  /* Same, in thread CPU time */
+double global_sw_pair_cost;     /* Full cost of a Start/Stop pair */
+#ifdef TSC_TIMER
+int global_use_tsc;             /* Real time is read from the TSC */
+double global_tsc_hz;           /* Calibrated TSC frequency */
+#endif
 
 /*
 ** Following global is the memory array.  This is used to store
-** original and aligned (modified) memory addresses.
+** original and aligned (modified) memory addresses, and the
+** size of each block.
 */
-ulong mem_array[2][MEM_ARRAY_SIZE];
+ulong mem_array[4][MEM_ARRAY_SIZE];
 int mem_array_ents;		/* # of active entries */
 #if defined(LINUX) || defined(OSX)
 pthread_mutex_t master_lock = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
+/*
+** Running totals kept by the memory array, i.e. of
+** AllocateMemory() with malloc.
+*/
+ulong mem_alloc_calls;          /* Blocks allocated */
+double mem_alloc_bytes;         /* Bytes allocated */
+ulong mem_live_bytes;           /* Bytes allocated and not freed */
+ulong mem_peak_bytes;           /* High-water mark of mem_live_bytes */
+ulong mem_huge_blocks;          /* Blocks backed by huge pages */
+ulong mem_thp_blocks;           /* Blocks only advised to use THP */
+ulong mem_huge_fallbacks;       /* Blocks that could not be */
+
+#ifdef MALLOCMEM
+static farvoid *huge_alloc(ulong nbytes, ulong *maplen);
+#endif
+
 /*********************************
 **  MEMORY MANAGEMENT ROUTINES  **
 *********************************/
@@ -78,9 +121,13 @@ pthread_mutex_t master_lock = PTHREAD_MUTEX_INITIALIZER;
 ** error code in the second argument.
 ** 10/95 Update:
 **  Added an associative array for memory alignment reasons.
-**  mem_array[2][MEM_ARRAY_SIZE]
+**  mem_array[4][MEM_ARRAY_SIZE]
 **   mem_array[0][n] = Actual address (from malloc)
 **   mem_array[1][n] = Aligned address
+**   mem_array[2][n] = Size in bytes (for cold-cache flushing)
+**   mem_array[3][n] = Length of the mapping, 0 if malloc'd
+** Blocks of HUGE_MINBYTES or more may be backed by huge pages,
+**  see huge_alloc().
 ** Currently, mem_array[][] is only used if you use malloc;
 **  it is not used for the 16-bit DOS and MAC versions.
 */
@@ -145,11 +192,20 @@ farvoid *AllocateMemory(unsigned long nbytes,   /* # of bytes to alloc */
     farvoid *returnval;             /* Return value */
     ulong true_addr;		/* True address */
     ulong adj_addr;			/* Adjusted address */
+    ulong maplen;                   /* Length if mmap'd */
+    ulong pad;                      /* Room for adjusting the address */
 #if defined(LINUX) || defined(OSX)
     pthread_mutex_lock(&master_lock);
 #endif
 
-    returnval=(farvoid *)malloc((size_t)(nbytes+2L*(long)global_align));
+    maplen=0;
+    pad=2L*(ulong)global_align;
+    if(global_offset!=OFFSET_NONE)
+        pad=2L*OFFSET_PAGE;
+    if(global_hugepages!=HUGE_OFF && nbytes>=HUGE_MINBYTES)
+        returnval=huge_alloc(nbytes+pad,&maplen);
+    else
+        returnval=(farvoid *)malloc((size_t)(nbytes+pad));
     if(returnval==(farvoid *)NULL)
         *errorcode=ERROR_MEMORY;
     else
@@ -159,17 +215,30 @@ farvoid *AllocateMemory(unsigned long nbytes,   /* # of bytes to alloc */
      ** Check for alignment
      */
     adj_addr=true_addr=(ulong)returnval;
-    if(global_align==0)
+    if(global_offset!=OFFSET_NONE)
+    {
+        /*
+         ** Alignment sweep: start of a page plus the offset,
+         ** or plus 64 bytes more for every block (staggered).
+         */
+        if(returnval!=(farvoid *)NULL)
+        {   adj_addr=(true_addr+OFFSET_PAGE-1)&~(ulong)(OFFSET_PAGE-1);
+            if(global_offset==OFFSET_STAGGER)
+                adj_addr+=(mem_alloc_calls%(OFFSET_PAGE/64))*64;
+            else
+                adj_addr+=(ulong)global_offset;
+        }
+    }
+    else if(global_align==0)
     {
-        if(AddMemArray(true_addr, adj_addr))
+        if(AddMemArray(true_addr, adj_addr, nbytes, maplen))
             *errorcode=ERROR_MEMARRAY_FULL;
 #if defined(LINUX) || defined(OSX)
         pthread_mutex_unlock(&master_lock);
 #endif
         return(returnval);
     }
-
-    if(global_align==1)
+    else if(global_align==1)
     {
         if(true_addr%2==0) adj_addr++;
     }
@@ -179,7 +248,7 @@ farvoid *AllocateMemory(unsigned long nbytes,   /* # of bytes to alloc */
         if(adj_addr%(global_align*2)==0) adj_addr+=global_align;
     }
     returnval=(void *)adj_addr;
-    if(AddMemArray(true_addr,adj_addr))
+    if(AddMemArray(true_addr,adj_addr,nbytes,maplen))
         *errorcode=ERROR_MEMARRAY_FULL;
 #if defined(LINUX) || defined(OSX)
     pthread_mutex_unlock(&master_lock);
@@ -250,14 +319,14 @@ void FreeMemory(farvoid *mempointer,    /* Pointer to memory block */
 #endif
 
 #ifdef MALLOCMEM
-    ulong adj_addr, true_addr;
+    ulong adj_addr, true_addr, maplen;
 
 #if defined(LINUX) || defined(OSX)
     pthread_mutex_lock(&master_lock);
 #endif
     /* Locate item in memory array */
     adj_addr=(ulong)mempointer;
-    if(RemoveMemArray(adj_addr, &true_addr))
+    if(RemoveMemArray(adj_addr, &true_addr, &maplen))
     {
         *errorcode=ERROR_MEMARRAY_NFOUND;
 #if defined(LINUX) || defined(OSX)
@@ -266,6 +335,11 @@ void FreeMemory(farvoid *mempointer,    /* Pointer to memory block */
         return;
     }
     mempointer=(void *)true_addr;
+#ifdef LINUX
+    if(maplen!=0)
+        munmap(mempointer,(size_t)maplen);
+    else
+#endif
     free(mempointer);
     *errorcode=0;
 #if defined(LINUX) || defined(OSX)
@@ -278,7 +352,8 @@ void FreeMemory(farvoid *mempointer,    /* Pointer to memory block */
 /****************************
 ** MoveMemory
 ** Moves n bytes from a to b.  Handles overlap.
-** In most cases, this is just a memmove operation.
+** In most cases, this is just a memmove operation (or the
+** implementation MEMMOVE selected, see movemem.c).
 ** But, not in DOS....noooo....
 */
 void MoveMemory( farvoid *destination,  /* Destination address */
@@ -286,6 +361,8 @@ void MoveMemory( farvoid *destination,  /* Destination address */
 		unsigned long nbytes)
 {
 
+    OPCOUNT_ADD(OP_BYTES,nbytes);
+
     /* +++16-bit DOS VERSION+++ */
 #ifdef DOS16MEM
 
@@ -293,7 +370,7 @@ void MoveMemory( farvoid *destination,  /* Destination address */
 
 #else
 
-    memmove(destination, source, nbytes);
+    (*move_impl)(destination, source, nbytes);
 
 #endif
 }
@@ -410,21 +487,30 @@ void InitMemArray(void)
 
 /***************************
 ** AddMemArray
-** Add a pair of items to the memory array.
+** Add an entry to the memory array.
 **  true_addr is the true address (mem_array[0][n])
-**  adj_addr is the adjusted address (mem_array[0][n])
+**  adj_addr is the adjusted address (mem_array[1][n])
+**  nbytes is the size of the block (mem_array[2][n])
 ** Returns 0 if ok
 ** -1 if not enough room
 */
 int AddMemArray(ulong true_addr,
-		ulong adj_addr)
+		ulong adj_addr,
+		ulong nbytes,
+		ulong maplen)
 {
     if(mem_array_ents>=MEM_ARRAY_SIZE)
         return(-1);
 
     mem_array[0][mem_array_ents]=true_addr;
     mem_array[1][mem_array_ents]=adj_addr;
+    mem_array[2][mem_array_ents]=nbytes;
+    mem_array[3][mem_array_ents]=maplen;
     mem_array_ents++;
+    mem_alloc_calls++;
+    mem_alloc_bytes+=(double)nbytes;
+    mem_live_bytes+=nbytes;
+    if(mem_live_bytes>mem_peak_bytes) mem_peak_bytes=mem_live_bytes;
     return(0);
 }
 
@@ -432,11 +518,12 @@ int AddMemArray(ulong true_addr,
 ** RemoveMemArray
 ** Given an adjusted address value (mem_array[1][n]), locate
 ** the entry and remove it from the mem_array.
-** Also returns the associated true address.
+** Also returns the associated true address and mapping
+** length.
 ** Returns 0 if ok
 ** -1 if not found.
 */
-int RemoveMemArray(ulong adj_addr,ulong *true_addr)
+int RemoveMemArray(ulong adj_addr,ulong *true_addr,ulong *maplen)
 {
     int i,j;
 
@@ -445,10 +532,14 @@ int RemoveMemArray(ulong adj_addr,ulong *true_addr)
         if(mem_array[1][i]==adj_addr)
         {       /* Found it..bubble stuff down */
             *true_addr=mem_array[0][i];
+            *maplen=mem_array[3][i];
+            mem_live_bytes-=mem_array[2][i];
             j=i;
             while(j+1<mem_array_ents)
             {       mem_array[0][j]=mem_array[0][j+1];
                 mem_array[1][j]=mem_array[1][j+1];
+                mem_array[2][j]=mem_array[2][j+1];
+                mem_array[3][j]=mem_array[3][j+1];
                 j++;
             }
             mem_array_ents--;
@@ -459,6 +550,99 @@ int RemoveMemArray(ulong adj_addr,ulong *true_addr)
     return(-1);
 }
 
+/*************************
+** huge_alloc
+** Allocate a block of nbytes backed by huge pages, following
+** global_hugepages.  HUGE_2M and HUGE_1G map explicit hugetlbfs
+** pages, which must have been reserved (vm.nr_hugepages); the
+** mapping length is returned in *maplen.  HUGE_THP, and the
+** explicit policies when no page is free, ask for transparent
+** huge pages on a 2 MB aligned malloc'd block instead, with
+** *maplen set to 0.  Blocks that do not get the pages of the
+** policy are counted in mem_huge_fallbacks, but still returned.
+** Called with master_lock held.
+*/
+#ifdef MALLOCMEM
+static farvoid *huge_alloc(ulong nbytes, ulong *maplen)
+{
+#ifdef LINUX
+    void *p;
+    ulong pagesize;
+    int flags;
+
+    *maplen=0;
+    if(global_hugepages==HUGE_2M || global_hugepages==HUGE_1G)
+    {
+        pagesize=global_hugepages==HUGE_1G ? 1UL<<30 : 1UL<<21;
+        flags=MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+        flags|=(global_hugepages==HUGE_1G ? 30 : 21)<<MAP_HUGE_SHIFT;
+#endif
+        p=mmap(NULL,(size_t)((nbytes+pagesize-1)&~(pagesize-1)),
+                PROT_READ|PROT_WRITE,flags,-1,0);
+        if(p!=MAP_FAILED)
+        {   *maplen=(nbytes+pagesize-1)&~(pagesize-1);
+            mem_huge_blocks++;
+            return((farvoid *)p);
+        }
+        mem_huge_fallbacks++;
+    }
+    if(posix_memalign(&p,(size_t)(1UL<<21),(size_t)nbytes)!=0)
+        return((farvoid *)NULL);
+#ifdef MADV_HUGEPAGE
+    if(madvise(p,(size_t)nbytes,MADV_HUGEPAGE)==0)
+    {   if(global_hugepages==HUGE_THP) mem_thp_blocks++;
+        return((farvoid *)p);
+    }
+#endif
+    if(global_hugepages==HUGE_THP) mem_huge_fallbacks++;
+    return((farvoid *)p);
+#else
+    *maplen=0;
+    mem_huge_fallbacks++;
+    return((farvoid *)malloc((size_t)nbytes));
+#endif
+}
+#endif
+
+/*************************
+** FlushMemArray
+** Write back and evict from all cache levels every block in
+** the memory array, i.e. all live benchmark data.  Used by
+** the cold-cache mode; a no-op where the CPU has no
+** user-level cache flush instruction.
+*/
+void FlushMemArray(void)
+{
+#if defined(MALLOCMEM) && (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__))
+    char *p, *end;
+    int i;
+
+#if defined(LINUX) || defined(OSX)
+    pthread_mutex_lock(&master_lock);
+#endif
+    for(i=0;i<mem_array_ents;i++)
+    {
+        p=(char *)mem_array[1][i];
+        end=p+mem_array[2][i];
+        for(p=(char *)((ulong)p & ~(ulong)63);p<end;p+=64)
+#if defined(__aarch64__)
+            __asm__ __volatile__("dc civac, %0" : : "r" (p) : "memory");
+#else
+            _mm_clflush(p);
+#endif
+    }
+#if defined(__aarch64__)
+    __asm__ __volatile__("dsb ish" : : : "memory");
+#else
+    _mm_mfence();
+#endif
+#if defined(LINUX) || defined(OSX)
+    pthread_mutex_unlock(&master_lock);
+#endif
+#endif
+}
+
 /**********************************
 **    FILE HANDLING ROUTINES     **
 **********************************/
@@ -937,14 +1121,130 @@ double TicksToFracSecs(unsigned long tickamount)
 
 #endif
 
+#ifdef TSC_TIMER
+
+/****************************
+** read_tsc
+** Read the time stamp counter.  rdtscp waits for all
+** earlier instructions to finish; the fence keeps later
+** ones from starting before the read.
+*/
+static unsigned long long read_tsc(void)
+{
+    unsigned int aux;
+    unsigned long long tsc;
+
+    tsc = __rdtscp(&aux);
+    _mm_lfence();
+    return tsc;
+}
+
+/****************************
+** tsc_invariant
+** Returns 1 if the CPU has rdtscp and an invariant TSC
+** (one that ticks at a constant rate in all P-, C- and
+** T-states), 0 otherwise.
+*/
+static int tsc_invariant(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx))
+        return 0;
+    if (!(edx & (1U << 27)))        /* RDTSCP */
+        return 0;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return (edx & (1U << 8)) != 0;  /* Invariant TSC */
+}
+
+/****************************
+** calibrate_tsc
+** Measure the TSC frequency against the real-time clock.
+** Three 20 ms rounds are taken; if they disagree by more
+** than 0.1% the TSC is not trusted and 0 is returned.
+*/
+static double calibrate_tsc(void)
+{
+    struct timespec t0, t1;
+    unsigned long long c0, c1;
+    double secs, hz[3], tmp;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        clock_gettime(global_realtime_cid, &t0);
+        c0 = read_tsc();
+        do {
+            clock_gettime(global_realtime_cid, &t1);
+            secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec)*1e-9;
+        } while (secs < 0.02);
+        c1 = read_tsc();
+        hz[i] = (double)(c1 - c0) / secs;
+    }
+
+    /* Sort the three rounds, then check their spread */
+    if (hz[0] > hz[1]) { tmp = hz[0]; hz[0] = hz[1]; hz[1] = tmp; }
+    if (hz[1] > hz[2]) { tmp = hz[1]; hz[1] = hz[2]; hz[2] = tmp; }
+    if (hz[0] > hz[1]) { tmp = hz[0]; hz[0] = hz[1]; hz[1] = tmp; }
+    if (hz[0] <= 0.0 || (hz[2] - hz[0]) / hz[1] > 0.001)
+        return 0.0;
+    return hz[1];
+}
+
+#endif
+
+#ifdef CLOCK_GETTIME
+
+/****************************
+** measure_overhead
+** Time empty Start/Stop pairs.  The smallest reading of an
+** empty region is the part of the stopwatch's own cost that
+** lands inside every timed region; StopStopWatch() takes it
+** back out.  The wall time of a long run of pairs is the full
+** cost a caller pays per timed region.
+*/
+static void measure_overhead(void)
+{
+    StopWatchStruct stopwatch;
+    struct timespec t0, t1;
+    double minreal, mincpu;
+    int i;
+
+    global_sw_overhead_real = 0.0;
+    global_sw_overhead_cpu = 0.0;
+    minreal = mincpu = 1.0;
+
+    clock_gettime(global_realtime_cid, &t0);
+    for (i = 0; i < SW_OVERHEAD_PAIRS; i++) {
+        ResetStopWatch(&stopwatch);
+        StartStopWatch(&stopwatch);
+        StopStopWatch(&stopwatch);
+        if (stopwatch.realsecs < minreal) minreal = stopwatch.realsecs;
+        if (stopwatch.cpusecs < mincpu) mincpu = stopwatch.cpusecs;
+    }
+    clock_gettime(global_realtime_cid, &t1);
+
+    global_sw_pair_cost = ((double)(t1.tv_sec - t0.tv_sec) +
+            (double)(t1.tv_nsec - t0.tv_nsec)*1e-9) / SW_OVERHEAD_PAIRS;
+    global_sw_overhead_real = minreal > 0.0 ? minreal : 0.0;
+    global_sw_overhead_cpu = mincpu > 0.0 ? mincpu : 0.0;
+}
+
+#endif
+
 /**********************************************
 ** InitStopWatch
 ** This function to be called when upon startup
 ** When CLOCK_GETTIME is enabled, it will
 ** a) choose realtime clock between CLOCK_MONOTONIC(preferred)
 **    or CLOCK_REALTIME
-** b) determine minimum iteration time based on clock resolution
-**    aim to reduce clock rounding error
+** b) switch real time over to the TSC if it is invariant
+**    and calibrates cleanly against that clock
+** c) measure the stopwatch's own overhead, which is subtracted
+**    from every timed region
+** d) determine minimum iteration time based on clock resolution
+**    and overhead, aim to keep rounding error and timer cost
+**    below 0.1% of each timed region
 */
 void InitStopWatch()
 {
@@ -961,12 +1261,28 @@ void InitStopWatch()
         err = clock_getres(global_realtime_cid, &ts);
     }
 
+#ifdef TSC_TIMER
+    global_use_tsc = 0;
+    if (!err && tsc_invariant()) {
+        global_tsc_hz = calibrate_tsc();
+        global_use_tsc = global_tsc_hz > 0.0;
+    }
+#endif
+
     if (!err) {
         /*
       .  * determine minimum iteration time to be 50x clock resolution but cap to 1s
         */
         timeres = ts.tv_sec + ts.tv_nsec * 1e-9;
+#ifdef TSC_TIMER
+        if (global_use_tsc)
+            timeres = 1.0 / global_tsc_hz;
+#endif
+        measure_overhead();
         global_min_itersec = timeres * 50.0;
+        if (global_min_itersec < global_sw_pair_cost / SW_OVERHEAD_SHARE) {
+            global_min_itersec = global_sw_pair_cost / SW_OVERHEAD_SHARE;
+        }
         if (global_min_itersec > 0.1) {
             global_min_itersec = 0.1;
         }
@@ -974,6 +1290,27 @@ void InitStopWatch()
 #endif
 }
 
+/****************************
+** DescribeStopWatch
+** Put a one-line description of the real-time source
+** used by the stopwatch into buffer.
+*/
+void DescribeStopWatch(char *buffer)
+{
+#if defined(TSC_TIMER)
+    if (global_use_tsc) {
+        sprintf(buffer, "rdtscp, invariant TSC at %.3f MHz", global_tsc_hz*1e-6);
+        return;
+    }
+#endif
+#if defined(CLOCK_GETTIME)
+    sprintf(buffer, "clock_gettime(%s)",
+            global_realtime_cid == CLOCK_MONOTONIC ? "CLOCK_MONOTONIC" : "CLOCK_REALTIME");
+#else
+    sprintf(buffer, "clock()");
+#endif
+}
+
 /****************************
 ** StartStopWatch
 ** Starts a software stopwatch.
@@ -995,6 +1332,22 @@ void StartStopWatch(StopWatchStruct *stopwatch)
     stopwatch->ticks = (unsigned long)win31tinfo.dwmsSinceStart;
 #elif defined(CLOCK_GETTIME)
     int err;
+
+    if (global_cold_on)
+        ColdEvict();
+    TraceRegionBegin();
+    NoiseCheckCpu();
+    FreqCheckCpu();
+    EnergyRegionBegin();
+    PerfRegionBegin();
+#ifdef OPCOUNT
+    opcount_timed=global_opcount_on;
+#endif
+#ifdef TSC_TIMER
+    if (global_use_tsc)
+        stopwatch->tsc = read_tsc();
+    else
+#endif
     clock_gettime(global_realtime_cid, &stopwatch->realtime);
     err = clock_gettime(CLOCK_THREAD_CPUTIME_ID, &stopwatch->cputime);
     if (err) {
@@ -1026,16 +1379,40 @@ void StopStopWatch(StopWatchStruct *stopwatch)
 #elif defined(CLOCK_GETTIME)
     int err;
     struct timespec cputime, realtime;
+    double realsecs, cpusecs;
 
-    clock_gettime(global_realtime_cid, &realtime);
-    stopwatch->realsecs += (double)(realtime.tv_sec - stopwatch->realtime.tv_sec) + (double)(realtime.tv_nsec - stopwatch->realtime.tv_nsec)*1e-9;
+#ifdef TSC_TIMER
+    if (global_use_tsc)
+        realsecs = (double)(read_tsc() - stopwatch->tsc) / global_tsc_hz;
+    else
+#endif
+    {
+        clock_gettime(global_realtime_cid, &realtime);
+        realsecs = (double)(realtime.tv_sec - stopwatch->realtime.tv_sec) + (double)(realtime.tv_nsec - stopwatch->realtime.tv_nsec)*1e-9;
+    }
 
     err = clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cputime);
     if (err) {
-        stopwatch->cpusecs += (double)((unsigned long)clock() - stopwatch->ticks)/(double)CLOCKS_PER_SEC;
+        cpusecs = (double)((unsigned long)clock() - stopwatch->ticks)/(double)CLOCKS_PER_SEC;
     } else {
-        stopwatch->cpusecs  += (double)(cputime.tv_sec  - stopwatch->cputime.tv_sec)  + (double)(cputime.tv_nsec  - stopwatch->cputime.tv_nsec)*1e-9;
+        cpusecs = (double)(cputime.tv_sec  - stopwatch->cputime.tv_sec)  + (double)(cputime.tv_nsec  - stopwatch->cputime.tv_nsec)*1e-9;
     }
+#ifdef OPCOUNT
+    opcount_timed=0;
+#endif
+    PerfRegionEnd();
+    EnergyRegionEnd();
+    NoiseCheckCpu();
+    FreqCheckCpu();
+    TraceRegionEnd();
+
+    /*
+     ** Take the stopwatch's own share back out of the region.
+     */
+    realsecs -= global_sw_overhead_real;
+    cpusecs -= global_sw_overhead_cpu;
+    if (realsecs > 0.0) stopwatch->realsecs += realsecs;
+    if (cpusecs > 0.0) stopwatch->cpusecs += cpusecs;
 #elif defined(CLOCKWCT)
     stopwatch->cpusecs += (double)((unsigned long)clock() - stopwatch->ticks)/(double)CLK_TCK;
     stopwatch->realsecs = stopwatch->cpusecs;
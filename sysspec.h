@@ -75,6 +75,44 @@ HANDLE hThlp;
 FARPROC lpfn;
 #endif
 
+/*
+** Invariant TSC timer.  On x86 the real-time half of the stopwatch
+** reads the time stamp counter with rdtscp, provided the CPU says
+** the TSC is invariant; InitStopWatch() calibrates it against
+** CLOCK_MONOTONIC.  Define NO_TSC to always use clock_gettime().
+*/
+#if defined(CLOCK_GETTIME) && !defined(NO_TSC) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define TSC_TIMER
+#endif
+
+/*
+** Stopwatch overhead measurement.  InitStopWatch() times this
+** many empty Start/Stop pairs, and keeps the minimum iteration
+** time long enough that one pair costs at most this share of it.
+*/
+#define SW_OVERHEAD_PAIRS 1000
+#define SW_OVERHEAD_SHARE 0.001
+
+/*
+** Page policies for large AllocateMemory() blocks (HUGEPAGES).
+** Only blocks of HUGE_MINBYTES or more are affected.
+*/
+#define HUGE_OFF 0              /* Normal pages */
+#define HUGE_THP 1              /* Transparent huge pages (madvise) */
+#define HUGE_2M 2               /* Explicit 2 MB pages (MAP_HUGETLB) */
+#define HUGE_1G 3               /* Explicit 1 GB pages (MAP_HUGETLB) */
+#define HUGE_MINBYTES (1UL<<21)
+
+/*
+** Block placement for the alignment sweep (ALIGNSWEEP).  With
+** global_offset set to an offset, every AllocateMemory() block
+** starts that many bytes into a page, overriding global_align.
+*/
+#define OFFSET_NONE -1L         /* Use global_align */
+#define OFFSET_STAGGER -2L      /* Block n at n*64 bytes into a page */
+#define OFFSET_PAGE 4096UL      /* Page size assumed */
+
 /*
 ** TYPEDEFS
 */
@@ -88,6 +126,9 @@ typedef struct {
 #ifdef CLOCK_GETTIME
     struct timespec cputime;
     struct timespec realtime;
+#endif
+#ifdef TSC_TIMER
+    unsigned long long tsc;
 #endif
     ulong ticks;
     double cpusecs;
@@ -97,9 +138,25 @@ typedef struct {
 /**************
 ** EXTERNALS **
 **************/
-extern ulong mem_array[2][MEM_ARRAY_SIZE];
+extern ulong mem_array[4][MEM_ARRAY_SIZE];
 extern int mem_array_ents;
+extern ulong mem_alloc_calls;
+extern double mem_alloc_bytes;
+extern ulong mem_live_bytes;
+extern ulong mem_peak_bytes;
+extern ulong mem_huge_blocks;
+extern ulong mem_thp_blocks;
+extern ulong mem_huge_fallbacks;
 extern int global_align;
+extern int global_hugepages;
+extern long global_offset;
+extern double global_sw_overhead_real;
+extern double global_sw_overhead_cpu;
+extern double global_sw_pair_cost;
+#ifdef TSC_TIMER
+extern int global_use_tsc;
+extern double global_tsc_hz;
+#endif
 
 /****************************
 **   FUNCTION PROTOTYPES   **
@@ -123,9 +180,11 @@ void FarDOSmemmove(farvoid *destination,
 
 void InitMemArray(void);
 
-int AddMemArray(ulong true_addr, ulong adj_addr);
+int AddMemArray(ulong true_addr, ulong adj_addr, ulong nbytes, ulong maplen);
 
-int RemoveMemArray(ulong adj_addr,ulong *true_addr);
+int RemoveMemArray(ulong adj_addr,ulong *true_addr,ulong *maplen);
+
+void FlushMemArray(void);
 
 void ReportError(char *context, int errorcode);
 
@@ -185,6 +244,8 @@ double TicksToFracSecs(unsigned long tickamount);
 
 void InitStopWatch();
 
+void DescribeStopWatch(char *buffer);
+
 void StartStopWatch(StopWatchStruct *stopwatch);
 
 void StopStopWatch(StopWatchStruct *stopwatch);
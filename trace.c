@@ -0,0 +1,410 @@
+
+/*
+** trace.c
+** Trace-event export of a benchmark run.
+**
+** Writes a JSON file in the Chrome trace-event format, which
+** Perfetto and chrome://tracing open directly.  Every timed
+** region (StartStopWatch() to StopStopWatch()) becomes an event:
+** "iteration" inside the benchmark threads, "adjust" for the
+** self-adjust probes that run before them and "probe" for the
+** start-up measurements (roofline).  The untimed stretches
+** of each benchmark thread (data setup, result checks) become
+** "untimed" events, and each thread's lifetime and each scored
+** sample of the main thread get an event of their own.  Every
+** event carries the thread id and the CPU it ended on.
+**
+** Events go to per-thread chunks, so the stopwatch hooks take no
+** locks except when a thread needs a new chunk; the file is
+** written once, at the end of the run.  A benchmark thread that
+** ends hands its chunk back for the next one to fill, so memory
+** grows with the number of events, not of threads started, and
+** the main thread tops up those spare chunks before each sample,
+** so that benchmark threads rarely allocate.  A test run in a
+** child process (--isolate) writes a file of its own, see
+** TraceChild().
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include "nmglobal.h"
+#include "trace.h"
+
+#ifdef LINUX
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+** Global parameters.
+*/
+int global_trace;               /* Trace requested */
+char global_tracefile[TRACEFILELEN];   /* Trace output file name */
+
+#ifdef LINUX
+
+#define TRACE_CHUNK 256         /* Events per chunk */
+
+/*
+** TYPEDEFS
+*/
+typedef struct {
+    char *name;             /* Event name */
+    char *test;             /* Test being run, or NULL */
+    double ts;              /* Start, usecs since TraceOpen() */
+    double dur;             /* Duration, usecs */
+    double score;           /* Sample score, or 0 */
+    int tid;                /* Thread id */
+    int cpu;                /* CPU at the end of the event */
+} TraceEventStruct;
+
+typedef struct TraceChunkStruct {
+    struct TraceChunkStruct *next;      /* In trace_chunks */
+    struct TraceChunkStruct *spare;     /* In trace_spare */
+    int n;                  /* Events used */
+    TraceEventStruct ev[TRACE_CHUNK];
+} TraceChunkStruct;
+
+static FILE *trace_fp;
+static double trace_t0;                 /* Time of TraceOpen() */
+static char *trace_test;                /* Test being run */
+static TraceChunkStruct *trace_chunks;  /* All chunks, newest first */
+static TraceChunkStruct *trace_spare;   /* Chunks with room, unused */
+static int trace_nspare;                /* Length of trace_spare */
+static pthread_mutex_t trace_lock=PTHREAD_MUTEX_INITIALIZER;
+
+/*
+** Per-thread state.
+*/
+static __thread TraceChunkStruct *trace_cur;   /* Chunk being filled */
+static __thread int trace_tid;
+static __thread int trace_inbench;      /* In a benchmark thread */
+static __thread double trace_thread0;   /* Benchmark thread start */
+static __thread double trace_lastend;   /* End of the last timed region */
+static __thread double trace_regionstart;
+static __thread double trace_sample0;   /* Sample start (main thread) */
+
+/*
+** PROTOTYPES
+*/
+static double trace_now(void);
+static TraceChunkStruct *trace_newchunk(void);
+static void trace_emit(char *name, double t0, double t1, double score);
+
+/**************
+** trace_now **
+***************
+** Microseconds since TraceOpen().
+*/
+static double trace_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return((double)ts.tv_sec*1e6+(double)ts.tv_nsec*1e-3-trace_t0);
+}
+
+/*******************
+** trace_newchunk **
+********************
+** Allocate an empty chunk and add it to trace_chunks.
+** Returns NULL if out of memory.
+*/
+static TraceChunkStruct *trace_newchunk(void)
+{
+    TraceChunkStruct *chunk;
+
+    chunk=(TraceChunkStruct *)malloc(sizeof(TraceChunkStruct));
+    if(chunk==(TraceChunkStruct *)NULL) return(chunk);
+    chunk->n=0;
+    chunk->spare=(TraceChunkStruct *)NULL;
+    pthread_mutex_lock(&trace_lock);
+    chunk->next=trace_chunks;
+    trace_chunks=chunk;
+    pthread_mutex_unlock(&trace_lock);
+    return(chunk);
+}
+
+/***************
+** trace_emit **
+****************
+** Record an event from t0 to t1 in the calling thread's chunk,
+** taking a spare one, or a new one, if it has none with room.
+*/
+static void trace_emit(char *name, double t0, double t1, double score)
+{
+    TraceEventStruct *ev;
+
+    if(trace_cur==(TraceChunkStruct *)NULL || trace_cur->n==TRACE_CHUNK)
+    {
+        pthread_mutex_lock(&trace_lock);
+        trace_cur=trace_spare;
+        if(trace_cur!=(TraceChunkStruct *)NULL)
+        {   trace_spare=trace_cur->spare;
+            trace_nspare--;
+        }
+        pthread_mutex_unlock(&trace_lock);
+        if(trace_cur==(TraceChunkStruct *)NULL)
+            trace_cur=trace_newchunk();
+        if(trace_cur==(TraceChunkStruct *)NULL) return;
+    }
+    if(trace_tid==0)
+        trace_tid=(int)syscall(SYS_gettid);
+    ev=&trace_cur->ev[trace_cur->n++];
+    ev->name=name;
+    ev->test=trace_test;
+    ev->ts=t0;
+    ev->dur=t1-t0;
+    ev->score=score;
+    ev->tid=trace_tid;
+    ev->cpu=sched_getcpu();
+}
+
+/**************
+** TraceOpen **
+***************
+** Create the trace file named by global_tracefile and start
+** the trace clock.
+** Returns 0 if ok, -1 if the file can't be created; in that
+** case reason holds a short explanation.
+*/
+int TraceOpen(char *reason)
+{
+    trace_fp=fopen(global_tracefile,"w");
+    if(trace_fp==(FILE *)NULL)
+    {   strcpy(reason,"cannot create trace file");
+        global_trace=0;
+        return(-1);
+    }
+    trace_t0=(double)0.0;
+    trace_t0=trace_now();
+    return(0);
+}
+
+/***************
+** TraceChild **
+****************
+** Called in the child process of an isolated test, numbered n:
+** trace it to <file>.<n>, which the child must close before it
+** exits.  The events inherited from the parent stay in the
+** parent's file.  Returns 0 if ok, -1 (with tracing off in the
+** child) if the file can't be created.
+*/
+int TraceChild(int n, char *reason)
+{
+    char name[TRACEFILELEN+16];
+
+    if(!global_trace) return(0);
+    sprintf(name,"%s.%d",global_tracefile,n);
+    fclose(trace_fp);
+    trace_fp=fopen(name,"w");
+    if(trace_fp==(FILE *)NULL)
+    {   strcpy(reason,"cannot create trace file");
+        global_trace=0;
+        return(-1);
+    }
+    trace_chunks=trace_spare=(TraceChunkStruct *)NULL;
+    trace_nspare=0;
+    trace_cur=(TraceChunkStruct *)NULL;
+    return(0);
+}
+
+/***************
+** TraceClose **
+****************
+** Write all events recorded so far and close the trace file.
+*/
+void TraceClose(void)
+{
+    TraceChunkStruct *chunk;
+    TraceEventStruct *ev;
+    int i, len, pid;
+
+    if(!global_trace) return;
+    global_trace=0;
+    pid=(int)getpid();
+    fprintf(trace_fp,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(trace_fp,"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"nbench\"}}",pid);
+    for(chunk=trace_chunks;chunk!=(TraceChunkStruct *)NULL;chunk=chunk->next)
+        for(i=0;i<chunk->n;i++)
+        {
+            ev=&chunk->ev[i];
+            /*
+             ** Test names are padded for the result table.
+             */
+            len=ev->test ? (int)strlen(ev->test) : 0;
+            while(len>0 && ev->test[len-1]==' ') len--;
+            fprintf(trace_fp,",\n{\"name\":\"%s\",\"cat\":\"%.*s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"cpu\":%d",
+                    ev->name,len ? len : 7,len ? ev->test : "startup",
+                    ev->ts,ev->dur,pid,ev->tid,ev->cpu);
+            if(ev->score>(double)0.0)
+                fprintf(trace_fp,",\"score\":%g",ev->score);
+            fprintf(trace_fp,"}}");
+        }
+    fprintf(trace_fp,"\n]}\n");
+    fclose(trace_fp);
+}
+
+/**************
+** TraceTest **
+***************
+** Name the test whose events follow (NULL for none).
+*/
+void TraceTest(char *name)
+{
+    trace_test=name;
+}
+
+/*********************
+** TraceSampleBegin **
+**********************
+** Mark the start of a sample on the main thread, after making
+** sure every benchmark thread of it can find a spare chunk.
+*/
+void TraceSampleBegin(void)
+{
+    TraceChunkStruct *chunk;
+
+    if(!global_trace) return;
+    while(trace_nspare<global_concurrency)
+    {
+        chunk=trace_newchunk();
+        if(chunk==(TraceChunkStruct *)NULL) break;
+        pthread_mutex_lock(&trace_lock);
+        chunk->spare=trace_spare;
+        trace_spare=chunk;
+        trace_nspare++;
+        pthread_mutex_unlock(&trace_lock);
+    }
+    trace_sample0=trace_now();
+}
+
+/*******************
+** TraceSampleEnd **
+********************
+** Record the sample started by TraceSampleBegin().
+*/
+void TraceSampleEnd(double score)
+{
+    if(!global_trace) return;
+    trace_emit("sample",trace_sample0,trace_now(),score);
+}
+
+/*********************
+** TraceThreadStart **
+**********************
+** A benchmark thread starts running its test.
+*/
+void TraceThreadStart(void)
+{
+    if(!global_trace) return;
+    trace_inbench=1;
+    trace_thread0=trace_lastend=trace_now();
+}
+
+/********************
+** TraceThreadStop **
+*********************
+** A benchmark thread is done: record its last untimed stretch
+** and its lifetime, and hand its chunk back if it has room.
+*/
+void TraceThreadStop(void)
+{
+    double now;
+
+    if(!global_trace || !trace_inbench) return;
+    now=trace_now();
+    trace_emit("untimed",trace_lastend,now,(double)0.0);
+    trace_emit("thread",trace_thread0,now,(double)0.0);
+    trace_inbench=0;
+    if(trace_cur!=(TraceChunkStruct *)NULL && trace_cur->n<TRACE_CHUNK)
+    {   pthread_mutex_lock(&trace_lock);
+        trace_cur->spare=trace_spare;
+        trace_spare=trace_cur;
+        trace_nspare++;
+        pthread_mutex_unlock(&trace_lock);
+    }
+    trace_cur=(TraceChunkStruct *)NULL;
+}
+
+/*********************
+** TraceRegionBegin **
+**********************
+** Called by StartStopWatch().  In a benchmark thread this
+** closes the untimed stretch since the previous timed region.
+*/
+void TraceRegionBegin(void)
+{
+    if(!global_trace) return;
+    trace_regionstart=trace_now();
+    if(trace_inbench)
+        trace_emit("untimed",trace_lastend,trace_regionstart,(double)0.0);
+}
+
+/*******************
+** TraceRegionEnd **
+********************
+** Called by StopStopWatch(): record the timed region.
+*/
+void TraceRegionEnd(void)
+{
+    if(!global_trace) return;
+    trace_lastend=trace_now();
+    trace_emit(trace_inbench ? "iteration" : trace_test ? "adjust" : "probe",
+            trace_regionstart,trace_lastend,(double)0.0);
+}
+
+#else
+
+/*
+** Elsewhere there is no trace.
+*/
+int TraceOpen(char *reason)
+{
+    strcpy(reason,"not supported on this system");
+    global_trace=0;
+    return(-1);
+}
+
+int TraceChild(int n, char *reason)
+{
+    return(0);
+}
+
+void TraceClose(void)
+{
+}
+
+void TraceTest(char *name)
+{
+}
+
+void TraceSampleBegin(void)
+{
+}
+
+void TraceSampleEnd(double score)
+{
+}
+
+void TraceThreadStart(void)
+{
+}
+
+void TraceThreadStop(void)
+{
+}
+
+void TraceRegionBegin(void)
+{
+}
+
+void TraceRegionEnd(void)
+{
+}
+
+#endif
@@ -0,0 +1,27 @@
+/*
+** trace.h
+** Header for trace.c
+** Trace-event (Chrome/Perfetto) export of a benchmark run.
+*/
+
+#define TRACEFILELEN 256        /* Longest trace file name */
+
+/*
+** EXTERNALS
+*/
+extern int global_trace;        /* Trace requested */
+extern char global_tracefile[]; /* Trace output file name */
+
+/*
+** PROTOTYPES
+*/
+int TraceOpen(char *reason);
+int TraceChild(int n, char *reason);
+void TraceClose(void);
+void TraceTest(char *name);
+void TraceSampleBegin(void);
+void TraceSampleEnd(double score);
+void TraceThreadStart(void);
+void TraceThreadStop(void);
+void TraceRegionBegin(void);
+void TraceRegionEnd(void);